@@ -1,12 +1,17 @@
 // Fill out your copyright notice in the Description page of Project Settings.
 
 #include "AdvancedWheelComponent.h"
+#include "Venine.h"
+#include "AdvancedWheelManager.h"
+#include "SimplexNoise.h"
 #include "DrawDebugHelpers.h"
 #include "WorldCollision.h"
 #include "Components/ActorComponent.h"
 #include "Components/StaticMeshComponent.h"
 #include "Components.h"
+#include "Curves/CurveFloat.h"
 #include "GameFramework/Actor.h"
+#include "PhysicalMaterials/PhysicalMaterial.h"
 #include "PhysicsEngine/PhysicsConstraintComponent.h"
 
 #include "PhysXIncludes.h"
@@ -18,9 +23,40 @@
 #define LOGW(format, ...) UE_LOG(LogTemp, Warning, TEXT(format), __VA_ARGS__)
 #define LOGE(format, ...) UE_LOG(LogTemp, Error, TEXT(format), __VA_ARGS__)
 
-FDebugFloatHistory SpringHistory;
-FDebugFloatHistory DampHistory;
-FDebugFloatHistory FrictionHistory;
+DECLARE_CYCLE_STAT(TEXT("Wheel Substep"), STAT_WheelSubstep, STATGROUP_AdvancedWheel);
+DECLARE_CYCLE_STAT(TEXT("Wheel Trace"), STAT_WheelTrace, STATGROUP_AdvancedWheel);
+DECLARE_CYCLE_STAT(TEXT("Wheel Forces"), STAT_WheelForces, STATGROUP_AdvancedWheel);
+DECLARE_CYCLE_STAT(TEXT("Wheel Roughness"), STAT_WheelRoughness, STATGROUP_AdvancedWheel);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Substeps"), STAT_WheelSubsteps, STATGROUP_AdvancedWheel);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Overlaps"), STAT_WheelOverlaps, STATGROUP_AdvancedWheel);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Sweeps"), STAT_WheelSweeps, STATGROUP_AdvancedWheel);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Hit Samples"), STAT_WheelHitSamples, STATGROUP_AdvancedWheel);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Reused Contacts"), STAT_WheelReusedContacts, STATGROUP_AdvancedWheel);
+
+static const uint8 NoContact = MAX_uint8;
+
+
+void FTireSampleStreams::SetNum(int32 Rings, int32 SamplesPerRing)
+{
+	const int32 Num = Rings * SamplesPerRing;
+
+	Compression.SetNumZeroed(Num);
+	Hit.SetNumZeroed(Num);
+	ContactPoint.SetNumZeroed(Num);
+	Normal.SetNumZeroed(Num);
+	LastSpring.SetNumZeroed(Num);
+	LastDamping.SetNumZeroed(Num);
+	LastFriction.SetNumZeroed(Num);
+	Weight.Init(1, Num);
+	ContactPlane.SetNumZeroed(Num);
+	SweepOrigin.SetNumZeroed(Num);
+	ContactAge.Init(NoContact, Num);
+	Cold.SetNum(Num);
+
+	Active.Reset(Num);
+
+	RingWeight.Init(1, Rings);
+}
 
 UAdvancedWheelComponent::UAdvancedWheelComponent()
 {
@@ -69,16 +105,200 @@ void UAdvancedWheelComponent::BeginPlay()
 
 	BRigidBody = Cast<UStaticMeshComponent>(GetOwner()->GetRootComponent())->GetBodyInstance()->GetPxRigidBody_AssumesLocked();
 
+	InitializeSamples();
+
+	HitParams = FCollisionQueryParams::DefaultQueryParam;
+	HitParams.AddIgnoredActor(GetOwner());
+
+	LOGE("Setting spheretrace radius to %f", SphereTraceRadius);
+	LOGE("Setting Poloidal density to %d", WheelPoloidalDensity);
+
+	Manager = FAdvancedWheelManager::Get(GetWorld());
+	Manager->Register(this);
+
+	ReplayFrame = 0;
+	Replay.WheelName = WheelComponentName;
+	Replay.Frames.Reset();
+	if (ReplayMode == ETireReplayMode::Replay) {
+		if (!Replay.Load(FTireReplay::GetWheelFilename(ReplayFile, WheelComponentName), WheelComponentName)) {
+			ReplayMode = ETireReplayMode::None;
+		} else if (WheelMesh && !WheelMesh->IsSimulatingPhysics()) {
+			// AddCustomPhysics drops callbacks of non simulating bodies, no substep would ever replay
+			LOGE("REPLAY : %s doesn't simulate physics, its replay won't run", *WheelComponentName);
+		}
+	}
+
+	TelemetryCursor = Telemetry.GetHead();
+	if (TelemetryCapture) {
+		const FString Filename = FPaths::ProjectSavedDir() / TEXT("Telemetry") / FString::Printf(TEXT("%s_%s_%s.ttel"), *TelemetryFile, *WheelComponentName, *FDateTime::Now().ToString());
+		TelemetryWriter = MakeUnique<FTireTelemetryWriter>(Telemetry, Filename);
+	}
+}
+
+void UAdvancedWheelComponent::InitializeSamples()
+{
+	BakeResponseTables();
+
+	ConfigureSamples(WheelToroidalDensity);
+	ReferenceTraceDensity = ActiveToroidalDensity * WheelPoloidalDensity;
+	SampleWeightScale = 1;
+	LOD = ETireLOD::Full;
+	PendingLOD.Set((int32)ETireLOD::Full);
+}
+
+// Baking here would rewrite the tables under a running substep
+void UAdvancedWheelComponent::BakeResponseCurves()
+{
+	PendingBake = true;
+}
+
+bool UAdvancedWheelComponent::ResponseInputsChanged() const
+{
+	return BakedPressureCurve != PressureCurve || BakedGripCurve != GripCurve || BakedSlipFrictionCurve != SlipFrictionCurve
+		|| BakedPressurePower != WheelTirePressurePower || BakedPressurePreload != WheelTirePressurePreload || BakedSlipCurveRange != SlipCurveRange;
+}
+
+void UAdvancedWheelComponent::BakeResponseTables()
+{
+	PendingBake = false;
+	BakedPressureCurve = PressureCurve;
+	BakedGripCurve = GripCurve;
+	BakedSlipFrictionCurve = SlipFrictionCurve;
+	BakedPressurePower = WheelTirePressurePower;
+	BakedPressurePreload = WheelTirePressurePreload;
+	BakedSlipCurveRange = SlipCurveRange;
+
+	const float PressurePower = WheelTirePressurePower;
+	const float PressurePreload = WheelTirePressurePreload;
+
+	if (PressureCurve) {
+		PressureTable.Bake(1, [this](float Compression) { return PressureCurve->GetFloatValue(Compression); });
+	} else {
+		PressureTable.Bake(1, [=](float Compression) { return (1 - FMath::Pow(1 - Compression, PressurePower))*(1. - PressurePreload) + PressurePreload; });
+	}
+
+	if (GripCurve) {
+		GripTable.Bake(1, [this](float Compression) { return GripCurve->GetFloatValue(Compression); });
+	} else {
+		GripTable.Bake(1, [](float Compression) { return (1. - FMath::Pow(1 - Compression, 5.))*.8 + .2; });
+	}
+
+	if (SlipFrictionCurve) {
+		SlipTable.Bake(SlipCurveRange, [this](float Slip) { return SlipFrictionCurve->GetFloatValue(Slip); });
+	} else {
+		SlipTable.Bake(SlipCurveRange, [](float Slip) { return 1.f; });
+	}
+}
+
+#if WITH_EDITOR
+void UAdvancedWheelComponent::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	BakeResponseCurves();
+}
+#endif
+
+void UAdvancedWheelComponent::ConfigureSamples(int32 ToroidalDensity)
+{
 	float ToroidalPerimeter = 6.283 * (WheelTireInnerRadius+WheelTireRadius);
 	float PoloidalPerimeter = 6.283 * (WheelTireRadius * WheelPoloidalAngularSpan / 360.);
 
-	SphereTraceRadius = (ToroidalPerimeter / WheelToroidalDensity) / 2.;
-	WheelPoloidalDensity = FMath::RoundToInt(PoloidalPerimeter / SphereTraceRadius);
+	ActiveToroidalDensity = ToroidalDensity;
+	SphereTraceRadius = (ToroidalPerimeter / ActiveToroidalDensity) / 2.;
+	WheelPoloidalDensity = FMath::Max(2, FMath::RoundToInt(PoloidalPerimeter / SphereTraceRadius));
 
-	TireImpacts.SetNum(WheelToroidalDensity*WheelPoloidalDensity);
+	Samples.SetNum(ActiveToroidalDensity, WheelPoloidalDensity);
+	Lanes.SetCapacity(ActiveToroidalDensity*WheelPoloidalDensity);
 
-	LOGE("Setting spheretrace radius to %f", SphereTraceRadius);
-	LOGE("Setting Poloidal density to %d", WheelPoloidalDensity);
+#if ENABLE_DRAW_DEBUG
+	DebugBatch.Reserve(ActiveToroidalDensity*WheelPoloidalDensity * 2, ActiveToroidalDensity*WheelPoloidalDensity);
+#endif
+}
+
+// Resizing here would free the streams under a running substep
+void UAdvancedWheelComponent::SetLOD(ETireLOD NewLOD)
+{
+	PendingLOD.Set((int32)NewLOD);
+}
+
+void UAdvancedWheelComponent::ApplyLOD(ETireLOD NewLOD)
+{
+	if (NewLOD == LOD) {
+		return;
+	}
+
+	// Forces restart from unfiltered samples, blend from what was applied last
+	LODBlendForce = LastNetForce;
+	LODBlendTorque = LastNetTorque;
+	LODBlendRemaining = LODBlendSubsteps;
+
+	LOD = NewLOD;
+
+	switch (LOD) {
+	case ETireLOD::Full:
+		ConfigureSamples(WheelToroidalDensity);
+		break;
+	case ETireLOD::Reduced:
+		ConfigureSamples(FMath::Max(3, FMath::RoundToInt(WheelToroidalDensity * LODReducedDensityScale)));
+		break;
+	case ETireLOD::SingleSweep:
+	case ETireLOD::Kinematic:
+		ActiveToroidalDensity = 1;
+		WheelPoloidalDensity = 1;
+		SphereTraceRadius = WheelTireRadius;
+		Samples.SetNum(1, 1);
+		Lanes.SetCapacity(1);
+		break;
+	}
+
+	// Every sample stands for the same share of the full resolution tire, springs keep their full resolution scale and cap
+	SampleWeightScale = ReferenceTraceDensity / (ActiveToroidalDensity * WheelPoloidalDensity);
+}
+
+int32 UAdvancedWheelComponent::GetLODSweepCost(ETireLOD InLOD) const
+{
+	switch (InLOD) {
+	case ETireLOD::Full: {
+		const int32 Sweeps = ReferenceTraceDensity;
+		return AdaptiveSampling ? FMath::Min(Sweeps, AdaptiveSampleBudget) : Sweeps;
+	}
+	case ETireLOD::Reduced: {
+		const int32 Sweeps = FMath::CeilToInt(ReferenceTraceDensity * LODReducedDensityScale * LODReducedDensityScale);
+		return AdaptiveSampling ? FMath::Min(Sweeps, AdaptiveSampleBudget) : Sweeps;
+	}
+	case ETireLOD::SingleSweep:
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+ETireLOD UAdvancedWheelComponent::GetDesiredLOD(float ViewDistance) const
+{
+	// No view to measure from, dedicated servers and headless runs stay at full resolution
+	if (!EnableLOD || ViewDistance < 0) return ETireLOD::Full;
+	if (ViewDistance >= LODKinematicDistance || !WheelMesh->WasRecentlyRendered(0.25)) return ETireLOD::Kinematic;
+	if (ViewDistance >= LODSingleSweepDistance) return ETireLOD::SingleSweep;
+	if (ViewDistance >= LODReducedDistance) return ETireLOD::Reduced;
+	return ETireLOD::Full;
+}
+
+void UAdvancedWheelComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (Manager.IsValid()) {
+		Manager->Unregister(this);
+		Manager.Reset();
+	}
+
+	TelemetryWriter.Reset();
+
+	const FString WheelReplayFile = FTireReplay::GetWheelFilename(ReplayFile, WheelComponentName);
+	if (ReplayMode == ETireReplayMode::Record && Replay.Frames.Num() > 0 && Replay.Save(WheelReplayFile)) {
+		LOGW("REPLAY : saved %d substeps of %s to %s", Replay.Frames.Num(), *WheelComponentName, *FTireReplay::GetPath(WheelReplayFile));
+	}
+
+	Super::EndPlay(EndPlayReason);
 }
 
 void UAdvancedWheelComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
@@ -88,24 +308,64 @@ void UAdvancedWheelComponent::TickComponent(float DeltaTime, ELevelTick TickType
 	GetWorld();
 	UWorld *World = GetWorld();;
 	
-	if (WheelMesh) {
-		WheelMesh->GetBodyInstance()->AddCustomPhysics(OnCalculateCustomPhysics);
+	// BeginPlay bails out before registering when the wheel has no rigid body
+	if (WheelMesh && Manager.IsValid()) {
+		Manager->UpdateLODs();
+
+		if (BatchedSimulation) {
+			Manager->QueueSubsteps(WheelMesh->GetBodyInstance());
+		} else {
+			WheelMesh->GetBodyInstance()->AddCustomPhysics(OnCalculateCustomPhysics);
+		}
 	}
 	
+	Stats = PendingStats;
+	Stats.ContactReuseRatio = Stats.TotalReusedContacts > 0 ? (float)Stats.TotalReusedContacts / (Stats.TotalReusedContacts + Stats.TotalTraces) : 0;
+	PendingStats = FWheelSubstepStats();
+
+	// Kept for Blueprints still reading the string keyed map
+	DebugData.Add(TEXT("TotalTraces"), Stats.TotalTraces);
+	DebugData.Add(TEXT("TotalHitTraces"), Stats.TotalHitTraces);
+
 	if (TextRender) {
-		TextRender->SetText(FText::FromString(CompositedText));
+		TextRender->SetText(FText::FromString(FString::Printf(TEXT("%s\nHITS : %d\nSPRNG : %d\nDAMP : %d\nFRIC : %d"),
+			*WheelComponentName, Stats.HitTraces, (int32)Stats.SpringForce, (int32)Stats.DampForce, (int32)(Stats.GripStrength > 0 ? Stats.FrictionForce / Stats.GripStrength : 0))));
 	}
 
 	FVector HistoryForward = FVector::CrossProduct(GetOwner()->GetActorRightVector(), FVector::UpVector).GetSafeNormal();
 	FTransform HistoryTransform = GetOwner()->GetActorTransform();
 
+#if ENABLE_DRAW_DEBUG
 	if (DrawTraceSpheres) {
+		// From the last substep's copy, a LOD change may resize the sample streams under this tick
+		DebugBatch.AddContactPoints(FLinearColor(FColor::Yellow));
+	}
+#endif
+
+	// Every substep since the last tick
+	TelemetryRecords.Reset();
+	Telemetry.Read(TelemetryCursor, TelemetryRecords);
 
-		for(FTireImpact TireImpact : TireImpacts){
+	if (DebugDraws) {
+		for (const FTireTelemetryRecord &Record : TelemetryRecords) {
+			SpringHistory.AddSample(Record.SpringForce);
+			DampHistory.AddSample(Record.DampForce);
+			FrictionHistory.AddSample(Record.FrictionForce);
+		}
+	}
 
-			//DrawDebugSphere(GetWorld(), TireImpact.EndPoint - (TireImpact.EndPoint-TireImpact.StartPoint).GetSafeNormal()*SphereTraceRadius, SphereTraceRadius, 8, FColor::Yellow, false, 0, 0, .2);
-			DrawDebugPoint(GetWorld(), TireImpact.EndPoint, SphereTraceRadius, FColor::Yellow, false, 0, 0);
+	if (DebugLogs && TelemetryRecords.Num() > 0) {
+		float MaxSlip = 0, MaxSpring = 0, MaxDamp = 0, MaxFriction = 0;
+		int32 CappedSprings = 0, CappedDampers = 0;
+		for (const FTireTelemetryRecord &Record : TelemetryRecords) {
+			MaxSlip = FMath::Max(MaxSlip, Record.MaxSlip);
+			MaxSpring = FMath::Max(MaxSpring, Record.SpringForce);
+			MaxDamp = FMath::Max(MaxDamp, Record.DampForce);
+			MaxFriction = FMath::Max(MaxFriction, Record.FrictionForce);
+			CappedSprings += Record.CappedSprings;
+			CappedDampers += Record.CappedDampers;
 		}
+		LOGW("%s SLIP : %d\tTOTSPRING : %d\tTOTDAMP : %d\tTOTFRIC : %d\tCAPPED : %d/%d", *WheelComponentName, (uint32)MaxSlip, (uint32)MaxSpring, (uint32)MaxDamp, (uint32)MaxFriction, CappedSprings, CappedDampers);
 	}
 
 	if(DebugDraws){
@@ -114,6 +374,10 @@ void UAdvancedWheelComponent::TickComponent(float DeltaTime, ELevelTick TickType
 		DrawDebugFloatHistory(*GetWorld(), FrictionHistory, GetOwner()->GetActorLocation() + HistoryForward *-200 + FVector(0, 0, 100), FVector2D(400, 50), FColor(255, 0, 0, 150), 0, 0, 0);
 	}
 
+#if ENABLE_DRAW_DEBUG
+	DebugBatch.Flush(GetWorld());
+#endif
+
 	SubstepIndex = 0;
 
 	//DrawDebugLine(World, Vertices[i], Vertices[(i + 1) % Vertices.Num()], Color, true, 0, 0, LineSize);
@@ -127,23 +391,27 @@ void UAdvancedWheelComponent::TickComponent(float DeltaTime, ELevelTick TickType
 
 void UAdvancedWheelComponent::GenerateTransforms()
 {
-	WheelTransform = WheelMesh->GetRelativeTransform() * WheelMesh->GetBodyInstance()->GetUnrealWorldTransform();
+	SetWheelTransform(WheelMesh->GetRelativeTransform() * WheelMesh->GetBodyInstance()->GetUnrealWorldTransform());
+}
+
+void UAdvancedWheelComponent::SetWheelTransform(const FTransform &InWheelTransform)
+{
+	WheelTransform = InWheelTransform;
 	WheelPosition = WheelTransform.GetLocation();
 	WheelRight = WheelTransform.TransformVector(FVector::RightVector);
 	WheelUp = FVector::VectorPlaneProject(FVector::UpVector, WheelRight).GetSafeNormal();
 	if (!WheelUp.IsUnit()) LOGE("UNSAFENORMAL WHEELUP");
 	WheelForward = WheelTransform.TransformVector(FVector::ForwardVector);
-
 }
 
-FTireImpact *UAdvancedWheelComponent::GetImpact(uint32 TraceIndex) {
-	return &(TireImpacts[TraceIndex%(WheelToroidalDensity*WheelPoloidalDensity)]);
+uint32 UAdvancedWheelComponent::GetSampleIndex(uint32 TraceIndex) {
+	return TraceIndex%(ActiveToroidalDensity*WheelPoloidalDensity);
 }
 
-FTireImpact *UAdvancedWheelComponent::GetImpact(uint32 TorI, uint32 PolI) {
-	TorI %= WheelToroidalDensity;
+uint32 UAdvancedWheelComponent::GetSampleIndex(uint32 TorI, uint32 PolI) {
+	TorI %= ActiveToroidalDensity;
 	PolI %= WheelPoloidalDensity;
-	return &TireImpacts[TorI * WheelPoloidalDensity + PolI];
+	return TorI * WheelPoloidalDensity + PolI;
 }
 
 FVector UAdvancedWheelComponent::GetPatchNormal(uint32 TraceIndex)
@@ -158,22 +426,22 @@ FVector UAdvancedWheelComponent::GetPatchNormal(uint32 TraceIndex)
 	(4) Center to Impact Normal (for sphere sweep)
 
 		Method 1
-	FVector PatchNormal = (TireImpact->EndPoint - TireImpact->StartPoint).GetSafeNormal();
+	FVector PatchNormal = (Samples.ContactPoint[Index] - Samples.Cold[Index].StartPoint).GetSafeNormal();
 
 		Method 2
-	FTireImpact *PatchL = GetImpact(TraceIndex - 1);
-	FTireImpact *PatchR = GetImpact(TraceIndex + 1);
-	FTireImpact *PatchF = GetImpact(TraceIndex + WheelPoloidalDensity);
-	FTireImpact *PatchB = GetImpact(TraceIndex - WheelPoloidalDensity);
-	FVector PatchNormal = FVector::CrossProduct(PatchL->EndPoint - PatchR->EndPoint, GetImpact(TraceIndex + WheelPoloidalDensity)->EndPoint - GetImpact(TraceIndex - WheelPoloidalDensity)->EndPoint).GetSafeNormal();
+	const FVector &PatchL = Samples.ContactPoint[GetSampleIndex(TraceIndex - 1)];
+	const FVector &PatchR = Samples.ContactPoint[GetSampleIndex(TraceIndex + 1)];
+	const FVector &PatchF = Samples.ContactPoint[GetSampleIndex(TraceIndex + WheelPoloidalDensity)];
+	const FVector &PatchB = Samples.ContactPoint[GetSampleIndex(TraceIndex - WheelPoloidalDensity)];
+	FVector PatchNormal = FVector::CrossProduct(PatchL - PatchR, PatchF - PatchB).GetSafeNormal();
 
 		Method 3
-	FVector PatchNormal = -TireImpact->HitResult.ImpactNormal;
+	FVector PatchNormal = -Samples.Cold[Index].HitResult.ImpactNormal;
 	*/
 
 	//  Method 4
-	FTireImpact *TireImpact = GetImpact(TraceIndex);
-	PatchNormal = (TireImpact->HitResult.ImpactPoint - TireImpact->HitResult.Location).GetSafeNormal();
+	const FHitResult &HitResult = Samples.Cold[GetSampleIndex(TraceIndex)].HitResult;
+	PatchNormal = (HitResult.ImpactPoint - HitResult.Location).GetSafeNormal();
 
 	return PatchNormal;
 }
@@ -191,86 +459,739 @@ void UAdvancedWheelComponent::AddDebugData(FString Key, int32 Value){
 	SetDebugData(Key, GetDebugData(Key) + Value);
 }
 
+// Fills RingWeight for the next TraceImpacts. Rings only carry weights, so forces stay normalized by TotalTraceDensity whatever the sample count.
+void UAdvancedWheelComponent::PlanRings(float DeltaTime)
+{
+	TArray<uint8> &RingWeight = Samples.RingWeight;
+	const int32 Rings = ActiveToroidalDensity;
+	const int32 BudgetRings = FMath::Max(1, AdaptiveSampleBudget / FMath::Max(1, WheelPoloidalDensity));
+	const bool Wraps = WheelToroidalAngularSpan >= 360;
+
+	// Groups of Stride consecutive rings starting at First, the first ring of each group stands for the whole group
+	auto StrideRun = [&](int32 First, int32 Count, int32 Stride) {
+		for (int32 Offset = 0; Offset < Count; Offset += Stride) {
+			RingWeight[(First + Offset) % Rings] = FMath::Min(Stride, Count - Offset);
+		}
+	};
+
+	if (!AdaptiveSampling || Rings <= BudgetRings) {
+		for (uint8 &Weight : RingWeight) Weight = 1;
+		if (!AdaptiveSampling) return;
+	}
+
+	// Rings in contact last substep
+	int32 FirstHitRing = INDEX_NONE;
+	for (int32 Ring = 0; Ring < Rings && FirstHitRing == INDEX_NONE; Ring++) {
+		for (int32 PolN = 0; PolN < WheelPoloidalDensity; PolN++) {
+			if (Samples.Hit[GetSampleIndex(Ring, PolN)]) {
+				FirstHitRing = Ring;
+				break;
+			}
+		}
+	}
+
+	// Airborne, nothing to predict from: uniform coverage within budget
+	if (FirstHitRing == INDEX_NONE) {
+		if (Rings > BudgetRings) {
+			for (uint8 &Weight : RingWeight) Weight = 0;
+			StrideRun(0, Rings, FMath::Min(FMath::DivideAndRoundUp(Rings, BudgetRings), 255));
+		}
+		return;
+	}
+
+	// Rings are fixed to the wheel so the ground slides across them at the wheel's spin rate, in both directions to stay sign agnostic
+	const float RingAngle = FMath::DegreesToRadians(WheelToroidalAngularSpan / Rings);
+	const float Spin = FMath::Abs(FVector::DotProduct(BodyState.AngularVelocity, WheelRight)) * DeltaTime;
+	const int32 Reach = FMath::CeilToInt(Spin / RingAngle) + AdaptiveArcMargin;
+
+	// Dense flag per ring, stored as 1 until strides are assigned
+	for (uint8 &Weight : RingWeight) Weight = 0;
+	for (int32 Ring = 0; Ring < Rings; Ring++) {
+		bool RingHit = false;
+		for (int32 PolN = 0; PolN < WheelPoloidalDensity && !RingHit; PolN++) {
+			RingHit = Samples.Hit[GetSampleIndex(Ring, PolN)] != 0;
+		}
+		if (!RingHit) continue;
+
+		for (int32 Offset = -Reach; Offset <= Reach; Offset++) {
+			const int32 Target = Ring + Offset;
+			if (Wraps) RingWeight[(Target + Rings) % Rings] = 1;
+			else if (Target >= 0 && Target < Rings) RingWeight[Target] = 1;
+		}
+	}
+
+	int32 DenseRings = 0;
+	for (uint8 Weight : RingWeight) DenseRings += Weight;
+
+	// Strides are stored as ring weights, hence the uint8 cap
+	const int32 DenseStride = FMath::Min(FMath::DivideAndRoundUp(DenseRings, BudgetRings), 255);
+	const int32 SparseBudget = BudgetRings - FMath::DivideAndRoundUp(DenseRings, DenseStride);
+	const int32 SparseStride = (AdaptiveSparseStride > 0 && SparseBudget > 0) ? FMath::Min(FMath::Max(AdaptiveSparseStride, FMath::DivideAndRoundUp(Rings - DenseRings, SparseBudget)), 255) : 0;
+
+	// Walk runs of equal density starting from a run boundary so groups never straddle the arc edge
+	int32 Start = 0;
+	if (Wraps) {
+		while (Start < Rings && RingWeight[Start] == RingWeight[(Start + Rings - 1) % Rings]) Start++;
+		if (Start == Rings) Start = 0;
+	}
+
+	int32 Ring = 0;
+	while (Ring < Rings) {
+		const int32 First = (Start + Ring) % Rings;
+		const bool Dense = RingWeight[First] == 1;
+		int32 Count = 1;
+		while (Ring + Count < Rings && (RingWeight[(Start + Ring + Count) % Rings] == 1) == Dense) Count++;
+
+		for (int32 Offset = 0; Offset < Count; Offset++) {
+			RingWeight[(First + Offset) % Rings] = 0;
+		}
+
+		if (Dense) StrideRun(First, Count, DenseStride);
+		else if (SparseStride > 0) StrideRun(First, Count, SparseStride);
+
+		Ring += Count;
+	}
+}
+
 void UAdvancedWheelComponent::TraceImpacts(){
 
-	/* TRACING SETUP */
-	FCollisionQueryParams HitParams = FCollisionQueryParams::DefaultQueryParam;
-	HitParams.AddIgnoredActor(GetOwner());
-	/*****************/
+	SCOPE_CYCLE_COUNTER(STAT_WheelTrace);
+
+	uint32 Overlaps = 0;
+	uint32 Traces = 0;
+	uint32 Reused = 0;
+
+	// ClampMax only holds in the editor, NoContact has to stay out of reach
+	const int32 MaxAge = FMath::Clamp(ContactReuseMaxAge, 1, NoContact - 1);
+
+	TireModel::FTireTorus Torus;
+	Torus.Position = ToTireVector(WheelPosition);
+	Torus.Forward = ToTireVector(WheelForward);
+	Torus.Right = ToTireVector(WheelRight);
+	Torus.InnerRadius = WheelTireInnerRadius;
+	Torus.TubeRadius = WheelTireRadius;
 
 	/* COLLECT ALL TRACES */
-	for (uint32 TorN = 0; TorN < (uint32)WheelToroidalDensity; TorN++) {
-		FVector ToroidalVector = WheelForward.RotateAngleAxis(((float)TorN / (uint32)WheelToroidalDensity) * WheelToroidalAngularSpan + WheelToroidalStartAngle, WheelRight);
+	for (uint32 TorN = 0; TorN < (uint32)ActiveToroidalDensity; TorN++) {
+		const TireModel::FTireVector RingDirection = TireModel::GetRingDirection(Torus, ((float)TorN / (uint32)ActiveToroidalDensity) * WheelToroidalAngularSpan + WheelToroidalStartAngle);
+		const FVector ToroidalVector = ToFVector(RingDirection);
 
 		FVector StartPoint = WheelPosition + ToroidalVector * WheelTireInnerRadius;
-		bool SkipTrace = false;
+		const uint8 RingWeight = Samples.RingWeight[TorN];
+		bool SkipTrace = RingWeight == 0;
+
+		// A ring holding reusable contacts is known to be near the ground
+		bool RingInContact = false;
+		if (ContactReuse && !SkipTrace) {
+			for (uint32 PolN = 0; PolN < (uint32)WheelPoloidalDensity && !RingInContact; PolN++) {
+				RingInContact = Samples.ContactAge[GetSampleIndex(TorN, PolN)] < MaxAge;
+			}
+		}
 
 		// SKIP IF USELESS
-		if (OptimizedTracing && !GetWorld()->OverlapAnyTestByChannel(StartPoint, FQuat::Identity, ECC_Visibility, FCollisionShape::MakeSphere(WheelTireRadius*1.2), HitParams)) {
+		Overlaps += OptimizedTracing && !RingInContact && !SkipTrace;
+		if (OptimizedTracing && !RingInContact && !SkipTrace && !(GroundQuery ? GroundQuery->OverlapSphere(StartPoint, WheelTireRadius*1.2) : GetWorld()->OverlapAnyTestByChannel(StartPoint, FQuat::Identity, ECC_Visibility, FCollisionShape::MakeSphere(WheelTireRadius*1.2), HitParams))) {
 			SkipTrace = true;
 		}
 
 		for (uint32 PolN = 0; PolN < (uint32)WheelPoloidalDensity; PolN++) {
 
-			FTireImpact *TireImpact = GetImpact(TorN, PolN);
+			const uint32 Index = GetSampleIndex(TorN, PolN);
+			FTireImpact &Cold = Samples.Cold[Index];
+			FVector &ContactPoint = Samples.ContactPoint[Index];
+			Samples.Weight[Index] = RingWeight * SampleWeightScale;
 
-			FVector PoloidalRotationAxis = FVector::CrossProduct(ToroidalVector, WheelRight).GetSafeNormal();
-			if (PoloidalRotationAxis.IsNearlyZero()) LOGE("UNSAFENORMAL POLOIDALROTATIONAXIS");
-			FVector PoloidalVector = ToroidalVector.RotateAngleAxis(((float)PolN / ((uint32)WheelPoloidalDensity - 1) - 0.5) * WheelPoloidalAngularSpan, PoloidalRotationAxis);
+			TireModel::FTireVector SegmentStart, SegmentTread, SegmentDirection;
+			TireModel::GetSampleSegment(Torus, RingDirection, ((float)PolN / ((uint32)WheelPoloidalDensity - 1) - 0.5) * WheelPoloidalAngularSpan, SegmentStart, SegmentTread, SegmentDirection);
+			const FVector PoloidalVector = ToFVector(SegmentDirection);
 
-			TireImpact->StartPoint = StartPoint - ToroidalVector * WheelTireRadius*1.2;
-			TireImpact->EndPoint = StartPoint + PoloidalVector * WheelTireRadius;
+			Cold.StartPoint = ToFVector(SegmentStart);
+			ContactPoint = ToFVector(SegmentTread);
 
-			float LineLength = (TireImpact->EndPoint - TireImpact->StartPoint).Size();
+			float LineLength = (ContactPoint - Cold.StartPoint).Size();
 
 
 
 			// Optimize out unnecessary traces
 			if (SkipTrace) {
-				TireImpact->LastDamping = FVector::ZeroVector;
-				TireImpact->Hit = false;
-				TireImpact->Compression = 0.;
+				Samples.LastDamping[Index] = FVector::ZeroVector;
+				Samples.Hit[Index] = false;
+				Samples.Compression[Index] = 0.;
+				Samples.ContactAge[Index] = NoContact;
 				continue;
 			}
 
-			AddDebugData("TotalTraces", 1);
+			const FVector SweepEnd = ContactPoint - PoloidalVector * SphereTraceRadius;
 
-			if (true) {
-				TireImpact->Hit = GetWorld()->SweepSingleByChannel(TireImpact->HitResult, TireImpact->StartPoint, TireImpact->EndPoint - PoloidalVector * SphereTraceRadius, FQuat::Identity, ECC_Visibility, FCollisionShape::MakeSphere(SphereTraceRadius), HitParams);
-			}
-			else {
-				TireImpact->Hit = GetWorld()->LineTraceSingleByChannel(TireImpact->HitResult, TireImpact->StartPoint, TireImpact->EndPoint, ECC_Visibility, HitParams);
+			if (ContactReuse && ReuseContact(Index, SweepEnd, LineLength)) {
+				Reused++;
+				continue;
 			}
 
-			if (TireImpact->Hit) {
+			Traces++;
+			SweepSample(Index, SweepEnd, LineLength);
+		}
+	}
+
+	PendingStats.TotalOverlaps += Overlaps;
+	PendingStats.TotalTraces += Traces;
+	PendingStats.TotalReusedContacts += Reused;
+	INC_DWORD_STAT_BY(STAT_WheelOverlaps, Overlaps);
+	INC_DWORD_STAT_BY(STAT_WheelSweeps, Traces);
+	INC_DWORD_STAT_BY(STAT_WheelReusedContacts, Reused);
+}
+
+// ContactPoint holds the unhit end point on entry and the contact on a hit
+bool UAdvancedWheelComponent::SweepSample(uint32 Index, const FVector &SweepEnd, float LineLength)
+{
+	FTireImpact &Cold = Samples.Cold[Index];
+	FVector &ContactPoint = Samples.ContactPoint[Index];
+
+	bool Hit;
+	if (GroundQuery) {
+		Hit = GroundQuery->SweepSphere(Cold.HitResult, Cold.StartPoint, SweepEnd, SphereTraceRadius);
+	}
+	else if (true) {
+		Hit = GetWorld()->SweepSingleByChannel(Cold.HitResult, Cold.StartPoint, SweepEnd, FQuat::Identity, ECC_Visibility, FCollisionShape::MakeSphere(SphereTraceRadius), HitParams);
+	}
+	else {
+		Hit = GetWorld()->LineTraceSingleByChannel(Cold.HitResult, Cold.StartPoint, ContactPoint, ECC_Visibility, HitParams);
+	}
+	Samples.Hit[Index] = Hit;
+	Samples.ContactAge[Index] = NoContact;
+
+	if (Hit) {
+
+		// ENSURING GOOD NORMAL TO PREVENT PHYSX LOCK
+		if (Cold.HitResult.Distance < KINDA_SMALL_NUMBER) {
+			Samples.Compression[Index] = 1. - KINDA_SMALL_NUMBER;
+			ContactPoint = FMath::Lerp<FVector>(Cold.StartPoint, ContactPoint, KINDA_SMALL_NUMBER);
+		} else {
+			ContactPoint = Cold.HitResult.ImpactPoint;
+			Samples.Compression[Index] = FMath::Clamp(1. - (ContactPoint - Cold.StartPoint).Size() / LineLength, 0., 1.);
+
+			Samples.ContactPlane[Index] = FPlane(Cold.HitResult.ImpactPoint, Cold.HitResult.ImpactNormal);
+			Samples.SweepOrigin[Index] = Cold.StartPoint;
+			Samples.ContactAge[Index] = 0;
+		}
+
+		Samples.Normal[Index] = GetPatchNormal(Index);
+	}
+
+	return Hit;
+}
+
+// One sphere the size of the tire tube, aimed where the tire last touched
+void UAdvancedWheelComponent::TraceSingleSweep()
+{
+	SCOPE_CYCLE_COUNTER(STAT_WheelTrace);
+
+	FVector Direction = FVector::VectorPlaneProject(SingleSweepDirection, WheelRight).GetSafeNormal();
+	if (Direction.IsNearlyZero()) Direction = -WheelUp;
+
+	Samples.Cold[0].StartPoint = WheelPosition + Direction * (WheelTireInnerRadius - WheelTireRadius*1.2);
+	Samples.ContactPoint[0] = WheelPosition + Direction * (WheelTireInnerRadius + WheelTireRadius);
+	Samples.Weight[0] = ContactFraction * ReferenceTraceDensity;
+
+	const float LineLength = (Samples.ContactPoint[0] - Samples.Cold[0].StartPoint).Size();
+	const FVector SweepEnd = Samples.ContactPoint[0] - Direction * SphereTraceRadius;
+
+	// Kinematic wheels sweep once per frame, the other substeps slide on that contact plane
+	if (LOD == ETireLOD::Kinematic && SubstepIndex > 0 && ReuseContact(0, SweepEnd, LineLength, true)) {
+		PendingStats.TotalReusedContacts++;
+		INC_DWORD_STAT(STAT_WheelReusedContacts);
+		return;
+	}
+
+	PendingStats.TotalTraces++;
+	INC_DWORD_STAT(STAT_WheelSweeps);
+
+	if (SweepSample(0, SweepEnd, LineLength)) {
+		SingleSweepDirection = (Samples.ContactPoint[0] - WheelPosition).GetSafeNormal();
+	}
+}
+
+// Sphere sweep against the sample's cached contact plane, false when the sample has to be swept for real
+bool UAdvancedWheelComponent::ReuseContact(uint32 Index, const FVector &SweepEnd, float LineLength, bool IgnoreThresholds)
+{
+	uint8 &Age = Samples.ContactAge[Index];
+	if (Age == NoContact || (!IgnoreThresholds && Age >= FMath::Clamp(ContactReuseMaxAge, 1, NoContact - 1))) {
+		return false;
+	}
+
+	const FVector &StartPoint = Samples.Cold[Index].StartPoint;
+	if (!IgnoreThresholds && FVector::DistSquared(StartPoint, Samples.SweepOrigin[Index]) > FMath::Square(ContactReuseMotionThreshold * SphereTraceRadius)) {
+		return false;
+	}
+
+	const FPlane &Plane = Samples.ContactPlane[Index];
+	const float StartDistance = Plane.PlaneDot(StartPoint);
+	const float Approach = FVector::DotProduct(Plane, SweepEnd - StartPoint);
+
+	// Starting inside the plane or moving away from it, let the real sweep decide
+	if (StartDistance <= SphereTraceRadius || Approach >= 0) {
+		return false;
+	}
+
+	const float Time = (SphereTraceRadius - StartDistance) / Approach;
+	if (Time > 1) {
+		return false;
+	}
+
+	const FVector Location = FMath::Lerp(StartPoint, SweepEnd, Time);
+	const FVector ImpactPoint = Location - FVector(Plane) * SphereTraceRadius;
+	const float Compression = FMath::Clamp(1. - (ImpactPoint - StartPoint).Size() / LineLength, 0., 1.);
+
+	if (!IgnoreThresholds && FMath::Abs(Compression - Samples.Compression[Index]) > ContactReusePenetrationThreshold) {
+		return false;
+	}
+
+	Samples.Hit[Index] = true;
+	Samples.Compression[Index] = Compression;
+	Samples.ContactPoint[Index] = ImpactPoint;
+	Samples.Normal[Index] = -FVector(Plane);
+	Age++;
+
+	return true;
+}
+
+// Noise relief on top of the gathered lanes, the traced samples are left alone so ReuseContact keeps comparing against real sweeps. Contacts are scaled by their material's Scale so all those sharing a seed go through one SimplexNoiseSeededSoA call,
+// the slope tilting the normal comes from two more evaluations one step along the contact's tangents.
+// Seeded noise hashes every lattice point, the table mode would repeat almost identically every 1 / Scale and feel like a washboard.
+void UAdvancedWheelComponent::ApplySurfaceRoughness()
+{
+	SCOPE_CYCLE_COUNTER(STAT_WheelRoughness);
+
+	// Tangent step, in noise space
+	const float Step = .05f;
+
+	FTireRoughnessBatch &Batch = Roughness;
+	Batch.Contacts.Reset();
+
+	float *NormalX = Lanes.Stream(FTireForceLanes::NormalX);
+	float *NormalY = Lanes.Stream(FTireForceLanes::NormalY);
+	float *NormalZ = Lanes.Stream(FTireForceLanes::NormalZ);
+	float *LaneCompression = Lanes.Stream(FTireForceLanes::Compression);
+
+	for (int32 Lane = 0; Lane < Lanes.Count; Lane++) {
+		const int32 Index = Samples.Active[Lane];
+
+		// Reused contacts keep the material of their last sweep
+		const FTireSurfaceRoughness *Surface = SurfaceRoughnessMaterials.Find(Samples.Cold[Index].HitResult.PhysMaterial.Get());
+		if (!Surface) {
+			Surface = &SurfaceRoughnessDefault;
+		}
+		if (Surface->Amplitude <= 0 || Surface->Scale <= 0) {
+			continue;
+		}
+
+		Batch.Contacts.Add({ Lane, *Surface });
+	}
+
+	const int32 Count = Batch.Contacts.Num();
+	if (Count == 0) {
+		return;
+	}
+
+	Batch.Contacts.Sort([](const FTireRoughnessBatch::FContact &A, const FTireRoughnessBatch::FContact &B) { return A.Surface.Seed < B.Surface.Seed; });
+
+	Batch.X.SetNumUninitialized(Count * 3, false);
+	Batch.Y.SetNumUninitialized(Count * 3, false);
+	Batch.Z.SetNumUninitialized(Count * 3, false);
+	Batch.Values.SetNumUninitialized(Count * 3, false);
+
+	for (int32 Rough = 0; Rough < Count; Rough++) {
+		const FTireRoughnessBatch::FContact &Contact = Batch.Contacts[Rough];
+		const FVector Position = Samples.ContactPoint[Samples.Active[Contact.Lane]] * Contact.Surface.Scale;
+
+		FVector TangentA, TangentB;
+		Samples.Normal[Samples.Active[Contact.Lane]].FindBestAxisVectors(TangentA, TangentB);
+
+		const FVector Points[3] = { Position, Position + TangentA * Step, Position + TangentB * Step };
+		for (int32 Point = 0; Point < 3; Point++) {
+			Batch.X[Rough * 3 + Point] = Points[Point].X;
+			Batch.Y[Rough * 3 + Point] = Points[Point].Y;
+			Batch.Z[Rough * 3 + Point] = Points[Point].Z;
+		}
+	}
+
+	// One call per run of contacts sharing a seed, a single one unless materials set different seeds
+	for (int32 First = 0; First < Count;) {
+		const int32 Seed = Batch.Contacts[First].Surface.Seed;
+		int32 Last = First + 1;
+		while (Last < Count && Batch.Contacts[Last].Surface.Seed == Seed) {
+			Last++;
+		}
+
+		USimplexNoise::SimplexNoiseSeededSoA(Batch.X.GetData() + First * 3, Batch.Y.GetData() + First * 3, Batch.Z.GetData() + First * 3, Batch.Values.GetData() + First * 3,
+			(Last - First) * 3, Seed, 1., false, SurfaceRoughnessLevels);
+		First = Last;
+	}
+
+	// Same span as FTireKernelParams::CompressionLength
+	const float CompressionLength = WheelTireRadius * 2.2;
+
+	for (int32 Rough = 0; Rough < Count; Rough++) {
+		const FTireRoughnessBatch::FContact &Contact = Batch.Contacts[Rough];
+		const FTireSurfaceRoughness &Surface = Contact.Surface;
+		const float *Values = Batch.Values.GetData() + Rough * 3;
+
+		const FVector &PatchNormal = Samples.Normal[Samples.Active[Contact.Lane]];
+		FVector TangentA, TangentB;
+		PatchNormal.FindBestAxisVectors(TangentA, TangentB);
+
+		// Relief height and slope, in world units
+		const float Height = Surface.Amplitude * Values[0];
+		const float SlopeScale = Surface.Amplitude * Surface.Scale / Step;
+		const FVector Slope = TangentA * ((Values[1] - Values[0]) * SlopeScale) + TangentB * ((Values[2] - Values[0]) * SlopeScale);
+
+		// Normal points into the ground: raised relief compresses more, and leans the normal down its slope
+		const int32 Lane = Contact.Lane;
+		LaneCompression[Lane] = FMath::Clamp(LaneCompression[Lane] + Height / CompressionLength, 0.f, 1.f - KINDA_SMALL_NUMBER);
+		const FVector RoughNormal = (PatchNormal + Slope).GetSafeNormal();
+		NormalX[Lane] = RoughNormal.X;
+		NormalY[Lane] = RoughNormal.Y;
+		NormalZ[Lane] = RoughNormal.Z;
+	}
+}
+
+void UAdvancedWheelComponent::FetchBodyState()
+{
+	const PxTransform CenterOfMassPose = WRigidBody->getGlobalPose() * WRigidBody->getCMassLocalPose();
+
+	BodyState.CenterOfMass = P2UVector(CenterOfMassPose.p);
+	BodyState.LinearVelocity = P2UVector(WRigidBody->getLinearVelocity());
+	BodyState.AngularVelocity = P2UVector(WRigidBody->getAngularVelocity());
+	BodyState.Mass = WRigidBody->getMass();
+}
+
+// Same math as TireModel::ComputeLaneForces, Width lanes at a time. Tail lanes past Count compute on stale data and are ignored.
+void UAdvancedWheelComponent::ComputeLaneForcesVectorized(FTireForceLanes &Lanes, const FTireKernelParams &Params)
+{
+	const VectorRegister Zero = VectorZero();
+	const VectorRegister One = VectorOne();
+	const VectorRegister Two = VectorSetFloat1(2.f);
+	const VectorRegister Tiny = VectorSetFloat1(SMALL_NUMBER);
+	const VectorRegister FrictionFilter = VectorSetFloat1(.2f);
+	const VectorRegister SpringFilter = VectorSetFloat1(.5f);
+	const VectorRegister GripMul = VectorSetFloat1(.8f);
+	const VectorRegister GripAdd = VectorSetFloat1(.2f);
+
+	const VectorRegister LinX = VectorSetFloat1(Params.Body.LinearVelocity.X);
+	const VectorRegister LinY = VectorSetFloat1(Params.Body.LinearVelocity.Y);
+	const VectorRegister LinZ = VectorSetFloat1(Params.Body.LinearVelocity.Z);
+	const VectorRegister AngX = VectorSetFloat1(Params.Body.AngularVelocity.X);
+	const VectorRegister AngY = VectorSetFloat1(Params.Body.AngularVelocity.Y);
+	const VectorRegister AngZ = VectorSetFloat1(Params.Body.AngularVelocity.Z);
+	const VectorRegister RightX = VectorSetFloat1(Params.WheelRight.X);
+	const VectorRegister RightY = VectorSetFloat1(Params.WheelRight.Y);
+	const VectorRegister RightZ = VectorSetFloat1(Params.WheelRight.Z);
+
+	const VectorRegister LateralMul = VectorSetFloat1(-Params.VelocityMul);
+	const VectorRegister Engine = VectorSetFloat1(Params.EnginePower);
+	const VectorRegister BreakMul = VectorSetFloat1(-(Params.BreakPower + 5.f));
+	const VectorRegister PressurePower = VectorSetFloat1(Params.PressurePower);
+	const VectorRegister PreloadMul = VectorSetFloat1(1.f - Params.PressurePreload);
+	const VectorRegister Preload = VectorSetFloat1(Params.PressurePreload);
+	const VectorRegister SpringScale = VectorSetFloat1(Params.SpringScale);
+	const VectorRegister DampScale = VectorSetFloat1(Params.DampScale);
+	const VectorRegister SpringCap = VectorSetFloat1(Params.SpringCap);
+	const VectorRegister DampCap = VectorSetFloat1(Params.DampCap);
+	const bool LinearPressure = Params.PressurePower == 1.f;
+
+	// Semi-implicit spring-damper, see the scalar path
+	const VectorRegister StiffnessScale = VectorSetFloat1(-Params.SpringScale / Params.CompressionLength);
+	const VectorRegister PressureSlopeMul = VectorSetFloat1(Params.PressurePower * (1.f - Params.PressurePreload));
+	const VectorRegister Timestep = VectorSetFloat1(Params.Timestep);
+	const VectorRegister InvSampleMass = VectorSetFloat1(1.f / Params.SampleMass);
+
+	for (int32 Lane = 0; Lane < Lanes.Count; Lane += FTireForceLanes::Width) {
+
+		auto Load = [&](FTireForceLanes::EStream S) { return VectorLoad(Lanes.Stream(S) + Lane); };
+		// No gather on VectorRegister, tables are read lane by lane
+		auto Lookup = [&](FTireForceLanes::EStream S, auto Read) {
+			float Values[FTireForceLanes::Width];
+			const float *Input = Lanes.Stream(S) + Lane;
+			for (int32 Index = 0; Index < FTireForceLanes::Width; Index++) Values[Index] = Read(Input[Index]);
+			return VectorLoad(Values);
+		};
+		auto Store = [&](FTireForceLanes::EStream S, const VectorRegister &V) { VectorStore(V, Lanes.Stream(S) + Lane); };
+		auto Dot = [](const VectorRegister &AX, const VectorRegister &AY, const VectorRegister &AZ, const VectorRegister &BX, const VectorRegister &BY, const VectorRegister &BZ) {
+			return VectorMultiplyAdd(AX, BX, VectorMultiplyAdd(AY, BY, VectorMultiply(AZ, BZ)));
+		};
+		// |V| for V = (X,Y,Z), zero stays zero
+		auto Length = [&](const VectorRegister &X, const VectorRegister &Y, const VectorRegister &Z) {
+			const VectorRegister LengthSquared = Dot(X, Y, Z, X, Y, Z);
+			return VectorMultiply(LengthSquared, VectorReciprocalSqrtAccurate(VectorMax(LengthSquared, Tiny)));
+		};
+
+		const VectorRegister RX = Load(FTireForceLanes::RelX);
+		const VectorRegister RY = Load(FTireForceLanes::RelY);
+		const VectorRegister RZ = Load(FTireForceLanes::RelZ);
+		const VectorRegister NX = Load(FTireForceLanes::NormalX);
+		const VectorRegister NY = Load(FTireForceLanes::NormalY);
+		const VectorRegister NZ = Load(FTireForceLanes::NormalZ);
+		const VectorRegister Compression = Load(FTireForceLanes::Compression);
+
+		// V + W x R
+		const VectorRegister VX = VectorAdd(LinX, VectorSubtract(VectorMultiply(AngY, RZ), VectorMultiply(AngZ, RY)));
+		const VectorRegister VY = VectorAdd(LinY, VectorSubtract(VectorMultiply(AngZ, RX), VectorMultiply(AngX, RZ)));
+		const VectorRegister VZ = VectorAdd(LinZ, VectorSubtract(VectorMultiply(AngX, RY), VectorMultiply(AngY, RX)));
+
+		/************ FRICTION ************/
+		// Lateral = WheelRight projected on the patch plane, zero when degenerate like GetSafeNormal
+		const VectorRegister RightDotN = Dot(RightX, RightY, RightZ, NX, NY, NZ);
+		VectorRegister LatX = VectorSubtract(RightX, VectorMultiply(RightDotN, NX));
+		VectorRegister LatY = VectorSubtract(RightY, VectorMultiply(RightDotN, NY));
+		VectorRegister LatZ = VectorSubtract(RightZ, VectorMultiply(RightDotN, NZ));
+		const VectorRegister LatLengthSquared = Dot(LatX, LatY, LatZ, LatX, LatY, LatZ);
+		const VectorRegister LatInvLength = VectorSelect(VectorCompareGT(LatLengthSquared, Tiny), VectorReciprocalSqrtAccurate(VectorMax(LatLengthSquared, Tiny)), Zero);
+		LatX = VectorMultiply(LatX, LatInvLength);
+		LatY = VectorMultiply(LatY, LatInvLength);
+		LatZ = VectorMultiply(LatZ, LatInvLength);
+
+		// Normal and lateral are unit and orthogonal, their cross product needs no normalization
+		const VectorRegister FwdX = VectorSubtract(VectorMultiply(NY, LatZ), VectorMultiply(NZ, LatY));
+		const VectorRegister FwdY = VectorSubtract(VectorMultiply(NZ, LatX), VectorMultiply(NX, LatZ));
+		const VectorRegister FwdZ = VectorSubtract(VectorMultiply(NX, LatY), VectorMultiply(NY, LatX));
+
+		const VectorRegister LateralSpeed = Dot(VX, VY, VZ, LatX, LatY, LatZ);
+		const VectorRegister ForwardSpeed = Dot(VX, VY, VZ, FwdX, FwdY, FwdZ);
+
+		const VectorRegister LateralForce = VectorMultiply(LateralSpeed, LateralMul);
+		const VectorRegister ForwardForce = VectorMultiplyAdd(ForwardSpeed, BreakMul, Engine);
+		VectorRegister FricX = VectorMultiplyAdd(LatX, LateralForce, VectorMultiply(FwdX, ForwardForce));
+		VectorRegister FricY = VectorMultiplyAdd(LatY, LateralForce, VectorMultiply(FwdY, ForwardForce));
+		VectorRegister FricZ = VectorMultiplyAdd(LatZ, LateralForce, VectorMultiply(FwdZ, ForwardForce));
+
+		Store(FTireForceLanes::LateralSpeed, VectorAbs(LateralSpeed));
+
+		if (Params.SlipTable) {
+			const VectorRegister SlipScale = Lookup(FTireForceLanes::LateralSpeed, [&](float Slip) { return Params.SlipTable->Evaluate(Slip); });
+			FricX = VectorMultiply(FricX, SlipScale);
+			FricY = VectorMultiply(FricY, SlipScale);
+			FricZ = VectorMultiply(FricZ, SlipScale);
+		}
+		Store(FTireForceLanes::FrictionSize, Length(FricX, FricY, FricZ));
+
+		// FILTERING FRICTION STACK
+		const VectorRegister LastFricX = Load(FTireForceLanes::FrictionX);
+		const VectorRegister LastFricY = Load(FTireForceLanes::FrictionY);
+		const VectorRegister LastFricZ = Load(FTireForceLanes::FrictionZ);
+		Store(FTireForceLanes::FrictionX, VectorMultiplyAdd(VectorSubtract(FricX, LastFricX), FrictionFilter, LastFricX));
+		Store(FTireForceLanes::FrictionY, VectorMultiplyAdd(VectorSubtract(FricY, LastFricY), FrictionFilter, LastFricY));
+		Store(FTireForceLanes::FrictionZ, VectorMultiplyAdd(VectorSubtract(FricZ, LastFricZ), FrictionFilter, LastFricZ));
+		/*********************************/
+
+		/************ TIRE PUSH ************/
+		const VectorRegister Relaxed = VectorSubtract(One, Compression);
+		VectorRegister RelaxedPow = Relaxed;
+		VectorRegister TireCompression;
+
+		if (Params.GripTable) {
+			Store(FTireForceLanes::Grip, Lookup(FTireForceLanes::Compression, [&](float C) { return Params.GripTable->Evaluate(C); }));
+		} else {
+			const VectorRegister Relaxed2 = VectorMultiply(Relaxed, Relaxed);
+			const VectorRegister Relaxed5 = VectorMultiply(VectorMultiply(Relaxed2, Relaxed2), Relaxed);
+			Store(FTireForceLanes::Grip, VectorMultiplyAdd(VectorSubtract(One, Relaxed5), GripMul, GripAdd));
+		}
+
+		if (Params.PressureTable) {
+			TireCompression = Lookup(FTireForceLanes::Compression, [&](float C) { return Params.PressureTable->Evaluate(C); });
+		} else {
+			RelaxedPow = LinearPressure ? Relaxed : VectorPow(Relaxed, PressurePower);
+			TireCompression = VectorMultiplyAdd(VectorSubtract(One, RelaxedPow), PreloadMul, Preload);
+		}
+
+		if (Params.SemiImplicit) {
+			// P (1 - C)^(P - 1) (1 - Preload), compression stays below 1 for gathered samples
+			const VectorRegister PressureSlope = Params.PressureTable
+				? Lookup(FTireForceLanes::Compression, [&](float C) { return Params.PressureTable->Slope(C); })
+				: VectorMultiply(PressureSlopeMul, LinearPressure ? One : VectorMultiply(RelaxedPow, VectorReciprocalAccurate(VectorMax(Relaxed, Tiny))));
+			const VectorRegister Stiffness = VectorMultiply(StiffnessScale, PressureSlope);
+			const VectorRegister Damping = VectorMultiply(VectorNegate(DampScale), TireCompression);
+			const VectorRegister HardDamping = VectorMultiplyAdd(Timestep, Stiffness, Damping);
+			const VectorRegister Denominator = VectorMultiplyAdd(VectorMultiply(Timestep, HardDamping), InvSampleMass, One);
+			const VectorRegister InvDenominator = VectorReciprocalAccurate(Denominator);
+
+			// Signed scales along the normal
+			const VectorRegister PressureScale = VectorMultiply(VectorMultiply(SpringScale, TireCompression), InvDenominator);
+			const VectorRegister DampingScale = VectorNegate(VectorMultiply(VectorMultiply(HardDamping, Dot(VX, VY, VZ, NX, NY, NZ)), InvDenominator));
+
+			Store(FTireForceLanes::Capped, Zero);
+			Store(FTireForceLanes::SpringX, VectorMultiply(NX, PressureScale));
+			Store(FTireForceLanes::SpringY, VectorMultiply(NY, PressureScale));
+			Store(FTireForceLanes::SpringZ, VectorMultiply(NZ, PressureScale));
+			Store(FTireForceLanes::SpringSize, VectorAbs(PressureScale));
+			Store(FTireForceLanes::DampingX, VectorMultiply(NX, DampingScale));
+			Store(FTireForceLanes::DampingY, VectorMultiply(NY, DampingScale));
+			Store(FTireForceLanes::DampingZ, VectorMultiply(NZ, DampingScale));
+			Store(FTireForceLanes::DampingSize, VectorAbs(DampingScale));
+			continue;
+		}
+
+		// Both forces lie along the unit normal, clamping their size is clamping the signed scale
+		const VectorRegister PressureScale = VectorMultiply(SpringScale, TireCompression);
+		const VectorRegister DampingScale = VectorMultiply(VectorMultiply(DampScale, TireCompression), Dot(VX, VY, VZ, NX, NY, NZ));
+		const VectorRegister ClampedPressure = VectorMax(VectorMin(PressureScale, SpringCap), VectorNegate(SpringCap));
+		const VectorRegister ClampedDamping = VectorMax(VectorMin(DampingScale, DampCap), VectorNegate(DampCap));
+
+		const VectorRegister SpringCapped = VectorSelect(VectorCompareGE(VectorAbs(PressureScale), SpringCap), One, Zero);
+		const VectorRegister DampCapped = VectorSelect(VectorCompareGE(VectorAbs(DampingScale), DampCap), Two, Zero);
+		Store(FTireForceLanes::Capped, VectorAdd(SpringCapped, DampCapped));
+
+		// FILTERING SPRING STACK
+		const VectorRegister LastSpringX = Load(FTireForceLanes::SpringX);
+		const VectorRegister LastSpringY = Load(FTireForceLanes::SpringY);
+		const VectorRegister LastSpringZ = Load(FTireForceLanes::SpringZ);
+		const VectorRegister SpringX = VectorMultiplyAdd(VectorSubtract(VectorMultiply(NX, ClampedPressure), LastSpringX), SpringFilter, LastSpringX);
+		const VectorRegister SpringY = VectorMultiplyAdd(VectorSubtract(VectorMultiply(NY, ClampedPressure), LastSpringY), SpringFilter, LastSpringY);
+		const VectorRegister SpringZ = VectorMultiplyAdd(VectorSubtract(VectorMultiply(NZ, ClampedPressure), LastSpringZ), SpringFilter, LastSpringZ);
+		Store(FTireForceLanes::SpringX, SpringX);
+		Store(FTireForceLanes::SpringY, SpringY);
+		Store(FTireForceLanes::SpringZ, SpringZ);
+		Store(FTireForceLanes::SpringSize, Length(SpringX, SpringY, SpringZ));
+
+		const VectorRegister LastDampX = Load(FTireForceLanes::DampingX);
+		const VectorRegister LastDampY = Load(FTireForceLanes::DampingY);
+		const VectorRegister LastDampZ = Load(FTireForceLanes::DampingZ);
+		const VectorRegister DampX = VectorMultiplyAdd(VectorSubtract(VectorMultiply(NX, ClampedDamping), LastDampX), SpringFilter, LastDampX);
+		const VectorRegister DampY = VectorMultiplyAdd(VectorSubtract(VectorMultiply(NY, ClampedDamping), LastDampY), SpringFilter, LastDampY);
+		const VectorRegister DampZ = VectorMultiplyAdd(VectorSubtract(VectorMultiply(NZ, ClampedDamping), LastDampZ), SpringFilter, LastDampZ);
+		Store(FTireForceLanes::DampingX, DampX);
+		Store(FTireForceLanes::DampingY, DampY);
+		Store(FTireForceLanes::DampingZ, DampZ);
+		Store(FTireForceLanes::DampingSize, Length(DampX, DampY, DampZ));
+		/************************************/
+	}
+}
+
+void UAdvancedWheelComponent::ComputeNetWrench(float TotalHitWeight)
+{
+	// Same torque addForceAtPos would produce, summed about the center of mass fetched this substep
+	const TireModel::FTireWrench Wrench = TireModel::ComputeNetWrench(Lanes, TotalHitWeight);
+
+	LastNetForce = ToFVector(Wrench.Force);
+	LastNetTorque = ToFVector(Wrench.Torque);
+}
+
+void UAdvancedWheelComponent::ApplyForces(float TotalHitWeight)
+{
+	const float FrictionScale = 1.f / TotalHitWeight;
+
+	ComputeNetWrench(TotalHitWeight);
+
+	switch (ForceApplication) {
+
+	case ETireForceApplication::PerSample:
+		for (int32 Index : Samples.Active) {
+			PxRigidBodyExt::addForceAtPos(*WRigidBody, U2PVector(Samples.LastFriction[Index] * (Samples.Weight[Index] * FrictionScale)), U2PVector(Samples.ContactPoint[Index]));
+		}
+
+		for (int32 Index : Samples.Active) {
+			PxRigidBodyExt::addForceAtPos(*WRigidBody, U2PVector((Samples.LastSpring[Index] + Samples.LastDamping[Index]) * Samples.Weight[Index]), U2PVector(Samples.ContactPoint[Index]));
+		}
+		break;
+
+	case ETireForceApplication::NetWrench:
+		WRigidBody->addForce(U2PVector(LastNetForce), PxForceMode::eFORCE);
+		WRigidBody->addTorque(U2PVector(LastNetTorque), PxForceMode::eFORCE);
+		break;
+
+	case ETireForceApplication::ContactPatches: {
+		// Each toroidal sector applies its summed force at the force-weighted centroid of its samples
+		const int32 PatchCount = FMath::Clamp(ContactPatchCount, 1, 16);
+		FVector PatchForce[16];
+		FVector PatchPoint[16];
+		float PatchWeight[16];
+
+		for (int32 Patch = 0; Patch < PatchCount; Patch++) {
+			PatchForce[Patch] = FVector::ZeroVector;
+			PatchPoint[Patch] = FVector::ZeroVector;
+			PatchWeight[Patch] = 0;
+		}
+
+		for (int32 Index : Samples.Active) {
+			const int32 Patch = (Index / WheelPoloidalDensity) * PatchCount / ActiveToroidalDensity;
+			const FVector Force = (Samples.LastFriction[Index] * FrictionScale + Samples.LastSpring[Index] + Samples.LastDamping[Index]) * Samples.Weight[Index];
+			const float Weight = Force.Size() + KINDA_SMALL_NUMBER;
+
+			PatchForce[Patch] += Force;
+			PatchPoint[Patch] += Samples.ContactPoint[Index] * Weight;
+			PatchWeight[Patch] += Weight;
+		}
 
-				// ENSURING GOOD NORMAL TO PREVENT PHYSX LOCK
-				if (TireImpact->HitResult.Distance < KINDA_SMALL_NUMBER) {
-					TireImpact->Compression = 1. - KINDA_SMALL_NUMBER;
-					TireImpact->EndPoint = FMath::Lerp<FVector>(TireImpact->StartPoint, TireImpact->EndPoint, KINDA_SMALL_NUMBER);
-				} else {
-					TireImpact->EndPoint = TireImpact->HitResult.ImpactPoint;
-					TireImpact->Compression = FMath::Clamp(1. - (TireImpact->EndPoint - TireImpact->StartPoint).Size() / LineLength, 0., 1.);
-				}
+		for (int32 Patch = 0; Patch < PatchCount; Patch++) {
+			if (PatchWeight[Patch] > 0) {
+				PxRigidBodyExt::addForceAtPos(*WRigidBody, U2PVector(PatchForce[Patch]), U2PVector(PatchPoint[Patch] / PatchWeight[Patch]));
 			}
 		}
+		break;
+	}
 	}
 }
 
 void UAdvancedWheelComponent::SubstepTick(float DeltaTime, FBodyInstance* BodyInstance)
 {
+	if (PrepareSubstep()) {
+		ComputeSubstep(DeltaTime);
+		ApplySubstep();
+	}
+}
 
-	GenerateTransforms();
+FTireReplayFrame UAdvancedWheelComponent::CaptureReplayFrame(float DeltaTime) const
+{
+	FTireReplayFrame Frame;
+	Frame.WheelTransform = WheelTransform;
+	Frame.CenterOfMass = BodyState.CenterOfMass;
+	Frame.LinearVelocity = BodyState.LinearVelocity;
+	Frame.AngularVelocity = BodyState.AngularVelocity;
+	Frame.Mass = BodyState.Mass;
+	Frame.DeltaTime = DeltaTime;
+	Frame.EnginePower = SubstepEnginePower;
+	Frame.BreakPower = SubstepBreakPower;
+	Frame.LOD = (uint8)LOD;
+	return Frame;
+}
 
-	// First substep of the tick
-	if(SubstepIndex == 0){
-		// Clean debug data
-		SetDebugData("TotalTraces", 0);
-		SetDebugData("TotalHitTraces", 0);
+void UAdvancedWheelComponent::ApplyReplayFrame(const FTireReplayFrame &Frame)
+{
+	SetWheelTransform(Frame.WheelTransform);
+	BodyState.CenterOfMass = Frame.CenterOfMass;
+	BodyState.LinearVelocity = Frame.LinearVelocity;
+	BodyState.AngularVelocity = Frame.AngularVelocity;
+	BodyState.Mass = Frame.Mass;
+	SubstepEnginePower = Frame.EnginePower;
+	SubstepBreakPower = Frame.BreakPower;
+	ApplyLOD((ETireLOD)Frame.LOD);
+}
+
+bool UAdvancedWheelComponent::PrepareSubstep()
+{
+	// Recorded poses stand in for the body's state, the body still has to simulate for substeps to run.
+	// Replays run at the LOD they were recorded at, SetLOD requests are ignored.
+	const bool Replaying = ReplayMode == ETireReplayMode::Replay;
+	if (Replaying) {
+		if (ReplayFrame >= Replay.Frames.Num()) {
+			return false;
+		}
+		ApplyReplayFrame(Replay.Frames[ReplayFrame++]);
+	} else {
+		ApplyLOD((ETireLOD)PendingLOD.GetValue());
 	}
 
+	if (PendingBake || ResponseInputsChanged()) {
+		BakeResponseTables();
+	}
+
+	if (Replaying) {
+		return true;
+	}
+
+	GenerateTransforms();
+
 	if (!GetOwner()->GetRootComponent()->IsSimulatingPhysics() || !WheelMesh->IsSimulatingPhysics()) {
-		return;
+		return false;
 	}
 
 	if (P2UVector(WRigidBody->getGlobalPose().p).ContainsNaN() && !Crashed) {
@@ -279,13 +1200,39 @@ void UAdvancedWheelComponent::SubstepTick(float DeltaTime, FBodyInstance* BodyIn
 		Crashed = true;
 	}
 
-	float MaxFrictionLockForce = 0;
-	float MaxFrictionVelForce = 0;
-	float MaxTireSpringForce = 0;
-	float MaxTireDampForce = 0;
+	// Single rigid body read for the whole substep
+	FetchBodyState();
+	SubstepEnginePower = EnginePower;
+	SubstepBreakPower = BreakPower;
+
+	return true;
+}
+
+void UAdvancedWheelComponent::ComputeSubstep(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_WheelSubstep);
+
+	if (ReplayMode == ETireReplayMode::Replay) {
+		DeltaTime = Replay.Frames[ReplayFrame - 1].DeltaTime;
+	} else if (ReplayMode == ETireReplayMode::Record) {
+		Replay.Frames.Add(CaptureReplayFrame(DeltaTime));
+	}
+
+	const uint32 StartCycles = FPlatformTime::Cycles();
+	const int32 TracesBefore = PendingStats.TotalTraces;
+	const int32 ReusedBefore = PendingStats.TotalReusedContacts;
+
+	FTireTelemetryRecord &Record = PendingRecord;
+	Record = FTireTelemetryRecord();
+
+#if ENABLE_DRAW_DEBUG
+	DebugBatch.SubstepLines.Reset();
+	DebugBatch.SubstepContacts.Reset();
+#endif
+
 	float MaxVelocity = 0;
 
-	float TotalTraceDensity = WheelToroidalDensity * WheelPoloidalDensity;
+	float TotalTraceDensity = ActiveToroidalDensity * WheelPoloidalDensity;
 
 	float TotalSpringForce = 0.;
 	float TotalDampForce = 0.;
@@ -294,16 +1241,34 @@ void UAdvancedWheelComponent::SubstepTick(float DeltaTime, FBodyInstance* BodyIn
 	float TotalGripStrength = 0;
 
 	uint32 TotalTraceHit = 0;
+	float TotalHitWeight = 0;
 
-	TArray<TTuple<PxVec3, PxVec3>> FrictionStack;
-	TArray<TTuple<PxVec3, PxVec3>> SpringStack;
-
+	// Keeps its allocation across substeps
+	Samples.Active.Reset();
 
 	/* PARAMS */
-	const float VelocityMul = WheelTireFrictionVelMul;
+	FTireKernelParams Params;
+	Params.VelocityMul = WheelTireFrictionVelMul;
+	Params.SpringCap = 200000;
+	Params.DampCap = 500000;
+	Params.SpringScale = -WheelTireKp / ReferenceTraceDensity;
+	Params.DampScale = -WheelTireKd / ReferenceTraceDensity;
+	Params.EnginePower = SubstepEnginePower;
+	Params.BreakPower = SubstepBreakPower;
+	Params.PressurePower = WheelTirePressurePower;
+	Params.PressurePreload = WheelTirePressurePreload;
+	Params.WheelRight = ToTireVector(WheelRight);
+	Params.SemiImplicit = SpringIntegration == ETireSpringIntegration::SemiImplicit;
+	Params.Timestep = DeltaTime;
+	// Line length of the center poloidal sample, compression 0 to 1 spans it
+	Params.CompressionLength = WheelTireRadius * 2.2;
+	if (TabulatedResponse) {
+		Params.PressureTable = &PressureTable;
+		Params.GripTable = &GripTable;
+		Params.SlipTable = &SlipTable;
+	}
+
 	const float StaticVelCap = 1000000;
-	const float SpringCap = 200000;
-	const float DampCap = 500000;
 
 	const float InnerTireOffset = 1.; // 0 starts at center, 1 starts at edges of tire (general case value), any value significantly beyond is probably meaningless
 	/**********/
@@ -311,164 +1276,240 @@ void UAdvancedWheelComponent::SubstepTick(float DeltaTime, FBodyInstance* BodyIn
 	bool Slipping = false;
 
 	// Trace all impacts
-	TraceImpacts();
+	if (LOD == ETireLOD::SingleSweep || LOD == ETireLOD::Kinematic) {
+		TraceSingleSweep();
+	} else {
+		PlanRings(DeltaTime);
+		HitParams.bReturnPhysicalMaterial = SurfaceRoughness;
+		TraceImpacts();
+	}
+
+	Params.Body = BodyState.ToTireBody();
 	
 	/******************/
 
+	/* GATHER HIT SAMPLES INTO LANES */
+	float *RelX = Lanes.Stream(FTireForceLanes::RelX);
+	float *RelY = Lanes.Stream(FTireForceLanes::RelY);
+	float *RelZ = Lanes.Stream(FTireForceLanes::RelZ);
+	float *NormalX = Lanes.Stream(FTireForceLanes::NormalX);
+	float *NormalY = Lanes.Stream(FTireForceLanes::NormalY);
+	float *NormalZ = Lanes.Stream(FTireForceLanes::NormalZ);
+	float *LaneCompression = Lanes.Stream(FTireForceLanes::Compression);
+	float *LaneWeights = Lanes.Stream(FTireForceLanes::Weight);
+	float *FrictionX = Lanes.Stream(FTireForceLanes::FrictionX);
+	float *FrictionY = Lanes.Stream(FTireForceLanes::FrictionY);
+	float *FrictionZ = Lanes.Stream(FTireForceLanes::FrictionZ);
+	float *SpringX = Lanes.Stream(FTireForceLanes::SpringX);
+	float *SpringY = Lanes.Stream(FTireForceLanes::SpringY);
+	float *SpringZ = Lanes.Stream(FTireForceLanes::SpringZ);
+	float *DampingX = Lanes.Stream(FTireForceLanes::DampingX);
+	float *DampingY = Lanes.Stream(FTireForceLanes::DampingY);
+	float *DampingZ = Lanes.Stream(FTireForceLanes::DampingZ);
+
+	float LaneWeight = 0;
 	for (uint32 TraceIndex = 0 ; TraceIndex < TotalTraceDensity ; TraceIndex++){
 
-		Slipping = false;
-
-		FTireImpact *TireImpact = GetImpact(TraceIndex);
-		
-		float GripStrength = 0;
-		if (TireImpact->Hit) {
-			//float TireCompression = (1-FMath::Pow(1-TireImpact->Compression,WheelTirePressurePower))*(1.-WheelTirePressurePreload)+ WheelTirePressurePreload;
-			GripStrength = (1. - FMath::Pow(1 - TireImpact->Compression, 5.))*.8 + .2;
-			TotalGripStrength += GripStrength;
-
-
-
-
-			/* GETTING TIREPATCH NORMAL */
-			FVector PatchNormal = GetPatchNormal(TraceIndex);
-
-			if (TireImpact->HitResult.Distance < KINDA_SMALL_NUMBER) {
-				LOGE("TIREIMPACT ERROR : %s", *((TireImpact->EndPoint - TireImpact->StartPoint).ToString()));
-			}
-			
-			if (PatchNormal.IsNearlyZero()) {
-				LOGE("AVERTED PATCHNORMAL CRISIS");
-				continue;
-				//PatchNormal = (GetImpact(TraceIndex)->EndPoint - GetImpact(TraceIndex)->StartPoint).GetSafeNormal();
-			}
-			/****************************/
-
-
-
-
-			/************ FRICTION ************/
-			FVector LateralVector = FVector::VectorPlaneProject(WheelRight, PatchNormal).GetSafeNormal();
-			if (LateralVector.ContainsNaN()) LOGE("LATERAL VECTOR IS NAN"); // TOFIX
-			FVector ForwardVector = FVector::CrossProduct(PatchNormal, LateralVector).GetSafeNormal();
-			if (ForwardVector.ContainsNaN()) LOGE("FORWARD VECTOR IS NAN"); // TOFIX
-			FVector LateralVelocity = P2UVector(PxRigidBodyExt::getVelocityAtPos(*WRigidBody, U2PVector(TireImpact->EndPoint))).ProjectOnToNormal(LateralVector);
-			FVector ForwardVelocity = P2UVector(PxRigidBodyExt::getVelocityAtPos(*WRigidBody, U2PVector(TireImpact->EndPoint))).ProjectOnToNormal(ForwardVector);
-			
-			FVector FrictionForce = (LateralVelocity * -VelocityMul) + (ForwardVector * EnginePower) + (ForwardVelocity * -(BreakPower + 5.));
-			//FrictionForce = FrictionForce.GetClampedToMaxSize(StaticVelCap);
+		if (!Samples.Hit[TraceIndex]) {
+			continue;
+		}
 
-// 			if (FrictionForce.Size() > 1000000) {
-// 				FrictionForce *= .1;
-// 				Slipping = true;
-// 			}
+		const float Compression = Samples.Compression[TraceIndex];
+		const FVector &PatchNormal = Samples.Normal[TraceIndex];
 
-			MaxVelocity = FMath::Max<float>(LateralVelocity.Size(), MaxVelocity);
-			TotalFrictionVelocityForce += FrictionForce.Size();
+		if (Compression >= 1. - KINDA_SMALL_NUMBER) {
+			LOGE("TIREIMPACT ERROR : %s", *((Samples.ContactPoint[TraceIndex] - Samples.Cold[TraceIndex].StartPoint).ToString()));
+		}
 
-			// FILTERING FRICTION STACK
-			FrictionForce = FMath::Lerp<FVector>(TireImpact->LastFriction, FrictionForce, .2);
-			TireImpact->LastFriction = FrictionForce;
-			FrictionStack.Add(TTuple<PxVec3, PxVec3>(U2PVector(FrictionForce), U2PVector(TireImpact->EndPoint)));
-			/*********************************/
+		if (PatchNormal.IsNearlyZero()) {
+			LOGE("AVERTED PATCHNORMAL CRISIS");
+			TotalGripStrength += (TabulatedResponse ? GripTable.Evaluate(Compression) : (1. - FMath::Pow(1 - Compression, 5.))*.8 + .2) * Samples.Weight[TraceIndex];
+			continue;
+			//PatchNormal = (ContactPoint - Samples.Cold[TraceIndex].StartPoint).GetSafeNormal();
+		}
 
+		const int32 Lane = Samples.Active.Add(TraceIndex);
+		LaneWeight += Samples.Weight[TraceIndex];
+		const FVector Rel = Samples.ContactPoint[TraceIndex] - BodyState.CenterOfMass;
+		RelX[Lane] = Rel.X;
+		RelY[Lane] = Rel.Y;
+		RelZ[Lane] = Rel.Z;
+		NormalX[Lane] = PatchNormal.X;
+		NormalY[Lane] = PatchNormal.Y;
+		NormalZ[Lane] = PatchNormal.Z;
+		LaneCompression[Lane] = Compression;
+		LaneWeights[Lane] = Samples.Weight[TraceIndex];
+		FrictionX[Lane] = Samples.LastFriction[TraceIndex].X;
+		FrictionY[Lane] = Samples.LastFriction[TraceIndex].Y;
+		FrictionZ[Lane] = Samples.LastFriction[TraceIndex].Z;
+		SpringX[Lane] = Samples.LastSpring[TraceIndex].X;
+		SpringY[Lane] = Samples.LastSpring[TraceIndex].Y;
+		SpringZ[Lane] = Samples.LastSpring[TraceIndex].Z;
+		DampingX[Lane] = Samples.LastDamping[TraceIndex].X;
+		DampingY[Lane] = Samples.LastDamping[TraceIndex].Y;
+		DampingZ[Lane] = Samples.LastDamping[TraceIndex].Z;
+	}
+	Lanes.Count = Samples.Active.Num();
 
+	// Single sweeps don't fetch the physical material
+	if (SurfaceRoughness && LOD != ETireLOD::SingleSweep && LOD != ETireLOD::Kinematic) {
+		ApplySurfaceRoughness();
+	}
 
-			/************ TIRE PUSH ************/
-			float TireCompression = (1-FMath::Pow(1-TireImpact->Compression,WheelTirePressurePower))*(1.-WheelTirePressurePreload)+ WheelTirePressurePreload;
+	// Sprung mass per unit of sample weight, every contact shares it
+	const float SprungMass = SemiImplicitSprungMass > 0 ? SemiImplicitSprungMass : BodyState.Mass;
+	Params.SampleMass = FMath::Max(SprungMass / FMath::Max(LaneWeight, 1.f), KINDA_SMALL_NUMBER);
+	/*********************************/
+
+	{
+		SCOPE_CYCLE_COUNTER(STAT_WheelForces);
+		if (VectorizedForceKernel) {
+			ComputeLaneForcesVectorized(Lanes, Params);
+		} else {
+			const int32 DroppedLanes = TireModel::ComputeLaneForces(Lanes, Params);
+			if (DroppedLanes > 0) LOGE("LATERAL OR FORWARD VECTOR IS NAN ON %d SAMPLES", DroppedLanes);
+		}
+	}
 
-			FVector PoloidalDelta = P2UVector(PxRigidBodyExt::getVelocityAtPos(*WRigidBody, U2PVector((TireImpact->EndPoint)))).ProjectOnTo(PatchNormal);
+	/* SCATTER FILTERED FORCES BACK */
+	const float *FrictionSize = Lanes.Stream(FTireForceLanes::FrictionSize);
+	const float *LateralSpeed = Lanes.Stream(FTireForceLanes::LateralSpeed);
+	const float *SpringSize = Lanes.Stream(FTireForceLanes::SpringSize);
+	const float *DampingSize = Lanes.Stream(FTireForceLanes::DampingSize);
+	const float *Grip = Lanes.Stream(FTireForceLanes::Grip);
+	const float *Capped = Lanes.Stream(FTireForceLanes::Capped);
 
-			FVector PressureForce = PatchNormal   * (-WheelTireKp / TotalTraceDensity) * TireCompression;
-			FVector DampingForce  = PoloidalDelta * (-WheelTireKd / TotalTraceDensity) * TireCompression;
+	for (int32 Lane = 0; Lane < Lanes.Count; Lane++) {
 
-			if (FVector::DotProduct(DampingForce, PoloidalDelta) > 0) {
-				DampingForce *= 1.;
-			}
+		const int32 TraceIndex = Samples.Active[Lane];
 
-			PressureForce = PressureForce.GetClampedToMaxSize(SpringCap);
-			DampingForce = DampingForce.GetClampedToMaxSize(DampCap);
+		const FVector FrictionForce(FrictionX[Lane], FrictionY[Lane], FrictionZ[Lane]);
+		Samples.LastFriction[TraceIndex] = FrictionForce;
+		Samples.LastSpring[TraceIndex] = FVector(SpringX[Lane], SpringY[Lane], SpringZ[Lane]);
+		Samples.LastDamping[TraceIndex] = FVector(DampingX[Lane], DampingY[Lane], DampingZ[Lane]);
 
-			if (DebugLogs && PressureForce.Size() == SpringCap) LOG("SPRING HIT CAP");
-			if (DebugLogs && DampingForce.Size() == DampCap) LOG("DAMP HIT CAP");
+		const float Weight = Samples.Weight[TraceIndex];
 
-			// FILTERING SPRING STACK
-			PressureForce = FMath::Lerp<FVector>(TireImpact->LastSpring, PressureForce, 0.5);
-			DampingForce = FMath::Lerp<FVector>(TireImpact->LastDamping, DampingForce, 0.5);
-			
-			TireImpact->LastSpring = PressureForce;
-			TireImpact->LastDamping = DampingForce;
+		MaxVelocity = FMath::Max<float>(LateralSpeed[Lane], MaxVelocity);
+		TotalFrictionVelocityForce += FrictionSize[Lane] * Weight;
+		TotalGripStrength += Grip[Lane] * Weight;
+		TotalSpringForce += SpringSize[Lane] * Weight;
+		TotalDampForce += DampingSize[Lane] * Weight;
+		TotalHitWeight += Weight;
 
-			SpringStack.Add(TTuple<PxVec3, PxVec3>(U2PVector(PressureForce + DampingForce), U2PVector(TireImpact->EndPoint)));
-			/************************************/
+		Record.CappedSprings += (int32)Capped[Lane] & 1 ? 1 : 0;
+		Record.CappedDampers += (int32)Capped[Lane] & 2 ? 1 : 0;
+		Record.CompressionHistogram[FMath::Min((int32)(Samples.Compression[TraceIndex] * FTireTelemetryRecord::HistogramBuckets), FTireTelemetryRecord::HistogramBuckets - 1)]++;
 
-			TotalSpringForce += PressureForce.Size();
-			TotalDampForce += DampingForce.Size();
+		TotalTraceHit++;
 
-			TotalTraceHit++;
+#if ENABLE_DRAW_DEBUG
+		if (DebugDraws && Lane % FMath::Max(1, DebugDrawStride) == 0) {
+			const float Compression = Samples.Compression[TraceIndex];
+			const FVector &ContactPoint = Samples.ContactPoint[TraceIndex];
+			const FVector &PatchNormal = Samples.Normal[TraceIndex];
 
-			if (DebugDraws) {
-				FColor LoadColor = FColor::Black;
-				FColor FrictionColor = FColor::Black;
+			FColor LoadColor = FColor::Black;
+			FColor FrictionColor = FColor::Black;
 
-				LoadColor += FColor(0, 255*(1 - TireImpact->Compression), 0);
-				LoadColor += FColor(TireImpact->Compression * 255, 0, 0);
+			LoadColor += FColor(0, 255*(1 - Compression), 0);
+			LoadColor += FColor(Compression * 255, 0, 0);
 
-				if (Slipping) FrictionColor = FColor::Blue;
-				else         FrictionColor = FColor::Orange;
+			if (Slipping) FrictionColor = FColor::Blue;
+			else         FrictionColor = FColor::Orange;
 
-							
+						
 
-				DrawDebugLine(GetWorld(), TireImpact->EndPoint, TireImpact->EndPoint + PatchNormal * -WheelTireRadius * (TireImpact->Compression + .1), LoadColor, false, 0, 0, TireImpact->Compression*1. + .1);
+			DebugBatch.SubstepLines.Emplace(ContactPoint, ContactPoint + PatchNormal * -WheelTireRadius * (Compression + .1), FLinearColor(LoadColor), 0, Compression*1. + .1, SDPG_World);
 
-				DrawDebugLine(GetWorld(), TireImpact->EndPoint, TireImpact->EndPoint - FrictionForce.GetSafeNormal()* (FMath::Pow(FrictionForce.Size(),1/2.)/10.), FrictionColor, false, 0, 0, 0.2);
-			}
+			DebugBatch.SubstepLines.Emplace(ContactPoint, ContactPoint - FrictionForce.GetSafeNormal()* (FMath::Pow(FrictionForce.Size(),1/2.)/10.), FLinearColor(FrictionColor), 0, 0.2, SDPG_World);
 		}
-
-		/****************/
-
-		// DEBUG DRAWING
-
+#endif
+	}
+	/********************************/
+
+	PendingStats.Substeps++;
+	PendingStats.TotalHitTraces += TotalTraceHit;
+	PendingStats.HitTraces = TotalTraceHit;
+	PendingStats.SpringForce = TotalSpringForce;
+	PendingStats.DampForce = TotalDampForce;
+	PendingStats.FrictionForce = TotalFrictionVelocityForce;
+	PendingStats.GripStrength = TotalGripStrength;
+	INC_DWORD_STAT(STAT_WheelSubsteps);
+	INC_DWORD_STAT_BY(STAT_WheelHitSamples, TotalTraceHit);
+
+	Record.Frame = GFrameCounter;
+	Record.DeltaTime = DeltaTime;
+	Record.Substep = SubstepIndex;
+	Record.LOD = (uint8)LOD;
+	Record.HitSamples = TotalTraceHit;
+	Record.Sweeps = PendingStats.TotalTraces - TracesBefore;
+	Record.ReusedContacts = PendingStats.TotalReusedContacts - ReusedBefore;
+	Record.SpringForce = TotalSpringForce;
+	Record.DampForce = TotalDampForce;
+	Record.FrictionForce = TotalFrictionVelocityForce;
+	Record.GripStrength = TotalGripStrength;
+	Record.MaxSlip = MaxVelocity;
+	Record.ComputeMicroseconds = FPlatformTime::ToMilliseconds(FPlatformTime::Cycles() - StartCycles) * 1000.f;
+
+	SubstepHitWeight = TotalHitWeight;
+
+	// Contact size and direction seen at full resolution, used by the single sweep LODs
+	if (TotalTraceHit > 0 && LOD != ETireLOD::SingleSweep && LOD != ETireLOD::Kinematic) {
+		FVector ContactDirection = FVector::ZeroVector;
+		for (int32 Index : Samples.Active) {
+			ContactDirection += (Samples.ContactPoint[Index] - WheelPosition) * Samples.Weight[Index];
+		}
+		SingleSweepDirection = ContactDirection.GetSafeNormal();
+		ContactFraction = FMath::Lerp(ContactFraction, TotalHitWeight / ReferenceTraceDensity, .1f);
 	}
 
-	AddDebugData("TotalHitTraces", TotalTraceHit);
-
-	MaxTireSpringForce = FMath::Max<float>(TotalSpringForce, MaxTireSpringForce);
-	MaxTireDampForce = FMath::Max<float>(TotalDampForce, MaxTireDampForce);
-	MaxFrictionVelForce = FMath::Max<float>(TotalFrictionVelocityForce, MaxFrictionVelForce * (TotalGripStrength/TotalTraceHit));
-
-	SpringHistory.AddSample(TotalSpringForce);
-	DampHistory.AddSample(TotalDampForce);
-	FrictionHistory.AddSample(TotalFrictionVelocityForce);
-
-	if (SubstepIndex == 0 && DebugLogs) {
-		LOGE("%s SLIP : %d", *(WheelMesh->GetName()), (uint32)MaxVelocity);
-  		LOGW("TOTSPRING : %d\t\tTOTDAMP : %d   \tTOTFRIC : %d", (uint32)(MaxTireSpringForce), (uint32)(MaxTireDampForce), (uint32)(MaxFrictionVelForce));
+#if ENABLE_DRAW_DEBUG
+	if (DrawTraceSpheres) {
+		// ClampMin only holds in the editor
+		const int32 DrawStride = FMath::Max(1, DebugDrawStride);
+		for (int32 TraceIndex = 0; TraceIndex < Samples.ContactPoint.Num(); TraceIndex += DrawStride) {
+			DebugBatch.SubstepContacts.Add(Samples.ContactPoint[TraceIndex]);
+		}
+		DebugBatch.SubstepContactRadius = SphereTraceRadius;
+	}
 
-		
-		MaxFrictionLockForce = 0;
-		MaxFrictionVelForce = 0;
-		MaxTireDampForce = 0;
-		MaxTireSpringForce = 0;
-		MaxVelocity = 0.;
+	if (DebugDraws || DrawTraceSpheres) {
+		DebugBatch.PublishSubstep();
 	}
+#endif
+}
 
-	// Apply friction stack
-	if (TotalTraceHit > 0) {
-		for (auto Tuple : FrictionStack) {
-			PxRigidBodyExt::addForceAtPos(*WRigidBody, Tuple.Get<0>()/ TotalTraceHit, Tuple.Get<1>());
+void UAdvancedWheelComponent::ApplySubstep()
+{
+	SCOPE_CYCLE_COUNTER(STAT_WheelForces);
+
+	// Apply friction and spring stacks
+	LastNetForce = FVector::ZeroVector;
+	LastNetTorque = FVector::ZeroVector;
+	if (PendingStats.HitTraces > 0) {
+		if (ReplayMode == ETireReplayMode::Replay) {
+			ComputeNetWrench(SubstepHitWeight);
+		} else {
+			ApplyForces(SubstepHitWeight);
 		}
+	}
 
-		for (auto Tuple : SpringStack) {
-			PxRigidBodyExt::addForceAtPos(*WRigidBody, Tuple.Get<0>(), Tuple.Get<1>());
-		}
+	// Fade out the gap between the old LOD's last wrench and the new one
+	if (LODBlendRemaining > 0 && ReplayMode != ETireReplayMode::Replay) {
+		const float Alpha = (float)LODBlendRemaining / FMath::Max(1, LODBlendSubsteps);
+		WRigidBody->addForce(U2PVector((LODBlendForce - LastNetForce) * Alpha), PxForceMode::eFORCE);
+		WRigidBody->addTorque(U2PVector((LODBlendTorque - LastNetTorque) * Alpha), PxForceMode::eFORCE);
+		LODBlendRemaining--;
 	}
 
-	CompositedText = *WheelComponentName + 
-					 FString("\nHITS : ") + FString::FromInt(TotalTraceHit) + 
-					 FString("\nSPRNG : ") + FString::FromInt(TotalSpringForce) + 
-					 FString("\nDAMP : ") + FString::FromInt(TotalDampForce) + 
-					 FString("\nFRIC : ") + FString::FromInt((TotalFrictionVelocityForce/TotalGripStrength));
-	
+	PendingRecord.NetForce[0] = LastNetForce.X;
+	PendingRecord.NetForce[1] = LastNetForce.Y;
+	PendingRecord.NetForce[2] = LastNetForce.Z;
+	PendingRecord.NetTorque[0] = LastNetTorque.X;
+	PendingRecord.NetTorque[1] = LastNetTorque.Y;
+	PendingRecord.NetTorque[2] = LastNetTorque.Z;
+	Telemetry.Push(PendingRecord);
+
 	SubstepIndex++;
 }
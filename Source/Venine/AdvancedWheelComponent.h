@@ -4,26 +4,113 @@
 
 #include "CoreMinimal.h"
 #include "Components/TextRenderComponent.h"
+#include "DrawDebugHelpers.h"
+#include "HAL/ThreadSafeCounter.h"
+#include "HAL/ThreadSafeBool.h"
+#include "TireModel/TireModel.h"
+#include "TireTelemetry.h"
+#include "TireReplay.h"
+#include "TireDebugBatch.h"
 #include "AdvancedWheelComponent.generated.h"
 
+class UPhysicalMaterial;
+
+UENUM(BlueprintType)
+enum class ETireLOD : uint8 {
+	// Full WheelToroidalDensity torus
+	Full,
+	// Torus at LODReducedDensityScale
+	Reduced,
+	// One tube-sized sweep toward the last contact
+	SingleSweep,
+	// One sweep per frame, substeps slide on its contact plane
+	Kinematic
+};
+
+UENUM(BlueprintType)
+enum class ETireReplayMode : uint8 {
+	None,
+	// Saves every substep's pose, velocities and inputs to ReplayFile on EndPlay
+	Record,
+	// Drives the tire model from ReplayFile instead of the body, forces are not applied.
+	// Substeps still come from the physics scene, so the wheel mesh has to simulate.
+	Replay
+};
+
+UENUM(BlueprintType)
+enum class ETireSpringIntegration : uint8 {
+	// Explicit forces, capped and filtered
+	Explicit,
+	// Backward Euler on each sample's spring-damper, holds larger substeps
+	SemiImplicit
+};
+
+UENUM(BlueprintType)
+enum class ETireForceApplication : uint8 {
+	// One addForceAtPos per hit sample
+	PerSample,
+	// All samples reduced to one force and torque about the center of mass
+	NetWrench,
+	// Samples grouped by toroidal sector, one force per sector
+	ContactPatches
+};
+
+// Typed tire counters, published once per game thread tick
+USTRUCT(BlueprintType)
+struct FWheelSubstepStats {
+	GENERATED_BODY()
+
+	// Summed over every substep of the last tick
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int32 Substeps = 0;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int32 TotalOverlaps = 0;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int32 TotalTraces = 0;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int32 TotalHitTraces = 0;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int32 TotalReusedContacts = 0;
+	// Reused contacts over reused contacts and sweeps
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	float ContactReuseRatio = 0;
+
+	// Last substep of the last tick
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int32 HitTraces = 0;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	float SpringForce = 0;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	float DampForce = 0;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	float FrictionForce = 0;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	float GripStrength = 0;
+};
+
+// Noise relief felt by the tire on one physical material, in place of collision geometry
+USTRUCT(BlueprintType)
+struct FTireSurfaceRoughness {
+	GENERATED_BODY()
+
+	// Height of the relief, cm
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0"))
+	float Amplitude = 0;
+	// Noise frequency, per cm
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0"))
+	float Scale = .1;
+	// Materials sharing a Scale get independent reliefs with different seeds
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	int32 Seed = 0;
+};
+
+// Cold per-sample metadata, only read by tooling and debug views
 USTRUCT()
 struct FTireImpact {
 	GENERATED_BODY()
 
 	UPROPERTY()
 	FVector StartPoint = FVector::ZeroVector;
-	UPROPERTY()
-	FVector EndPoint = FVector::ZeroVector;
-	UPROPERTY()
-	float Compression = 0;
-	UPROPERTY()
-	bool Hit = false;
-	UPROPERTY()
-	FVector LastSpring = FVector::ZeroVector;
-	UPROPERTY()
-	FVector LastDamping = FVector::ZeroVector;
-	UPROPERTY()
-	FVector LastFriction = FVector::ZeroVector;
 
 	UPROPERTY()
 	FHitResult HitResult;
@@ -34,6 +121,85 @@ struct FTireImpact {
 	bool Locked = false;
 };
 
+// Hot per-sample state, one stream per field so the substep loop only touches what it reads
+struct FTireSampleStreams {
+	TArray<float> Compression;
+	TArray<uint8> Hit;
+	TArray<FVector> ContactPoint;
+	TArray<FVector> Normal;
+	TArray<FVector> LastSpring;
+	TArray<FVector> LastDamping;
+	TArray<FVector> LastFriction;
+	// Share of the tire area a sample stands for, 1 when every sample is traced
+	TArray<float> Weight;
+
+	// Last swept contact, kept for ContactReuse. Ground is static so the plane stays in world space.
+	TArray<FPlane> ContactPlane;
+	TArray<FVector> SweepOrigin;
+	TArray<uint8> ContactAge;
+
+	TArray<FTireImpact> Cold;
+
+	// Indices of samples that produced a force this substep
+	TArray<int32> Active;
+
+	// Per toroidal ring, number of rings the traced ring stands for (0 skips it)
+	TArray<uint8> RingWeight;
+
+	void SetNum(int32 Rings, int32 SamplesPerRing);
+	int32 Num() const { return Compression.Num(); }
+};
+
+// Rough contacts of one substep, evaluated by one SimplexNoiseSeededSoA call per seed
+struct FTireRoughnessBatch {
+	struct FContact {
+		int32 Lane;
+		FTireSurfaceRoughness Surface;
+	};
+	// Sorted by seed
+	TArray<FContact> Contacts;
+	// Noise space positions, three per contact: the contact, then one step along each of its tangents
+	TArray<float> X;
+	TArray<float> Y;
+	TArray<float> Z;
+	TArray<float> Values;
+};
+
+FORCEINLINE TireModel::FTireVector ToTireVector(const FVector &V) { return TireModel::FTireVector(V.X, V.Y, V.Z); }
+FORCEINLINE FVector ToFVector(const TireModel::FTireVector &V) { return FVector(V.X, V.Y, V.Z); }
+
+// Rigid body state read once per substep, point velocities are V + W x (P - CenterOfMass)
+struct FTireBodyState {
+	FVector CenterOfMass = FVector::ZeroVector;
+	FVector LinearVelocity = FVector::ZeroVector;
+	FVector AngularVelocity = FVector::ZeroVector;
+	float Mass = 1;
+
+	FVector GetVelocityAt(const FVector &Point) const { return LinearVelocity + FVector::CrossProduct(AngularVelocity, Point - CenterOfMass); }
+
+	TireModel::FTireBody ToTireBody() const
+	{
+		TireModel::FTireBody Body;
+		Body.CenterOfMass = ToTireVector(CenterOfMass);
+		Body.LinearVelocity = ToTireVector(LinearVelocity);
+		Body.AngularVelocity = ToTireVector(AngularVelocity);
+		Body.Mass = Mass;
+		return Body;
+	}
+};
+
+using TireModel::FTireForceLanes;
+using TireModel::FTireResponseTable;
+using TireModel::FTireKernelParams;
+
+// Stands in for the world's scene queries, lets the tire model run without a level
+class ITireGroundQuery {
+public:
+	virtual ~ITireGroundQuery() {}
+	virtual bool SweepSphere(FHitResult &OutHit, const FVector &Start, const FVector &End, float Radius) const = 0;
+	virtual bool OverlapSphere(const FVector &Center, float Radius) const = 0;
+};
+
 UCLASS( ClassGroup=(Custom), meta=(BlueprintSpawnableComponent) )
 class VENINE_API UAdvancedWheelComponent : public UActorComponent
 {
@@ -44,13 +210,57 @@ public:
 	UAdvancedWheelComponent();
 	virtual void BeginPlay() override;
 	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
 	void SubstepTick(float DeltaTime, FBodyInstance* BodyInstance);
 
+	// SubstepTick phases. Prepare reads PhysX and Apply writes it, Compute only touches this wheel and scene queries so it can run on any thread.
+	bool PrepareSubstep();
+	void ComputeSubstep(float DeltaTime);
+	void ApplySubstep();
+
 	void GenerateTransforms();
-	FTireImpact *GetImpact(uint32 TraceIndex);
-	FTireImpact *GetImpact(uint32 TorI, uint32 PolI);
+	void SetWheelTransform(const FTransform &InWheelTransform);
+	// Sample layout and response tables, done by BeginPlay
+	void InitializeSamples();
+	FTireReplayFrame CaptureReplayFrame(float DeltaTime) const;
+	void ApplyReplayFrame(const FTireReplayFrame &Frame);
+	// Net wrench of the last ComputeSubstep about BodyState.CenterOfMass, into LastNetForce and LastNetTorque
+	void ComputeNetWrench(float TotalHitWeight);
+	uint32 GetSampleIndex(uint32 TraceIndex);
+	uint32 GetSampleIndex(uint32 TorI, uint32 PolI);
 	FVector GetPatchNormal(uint32 TraceIndex);
 	void TraceImpacts();
+	void TraceSingleSweep();
+	bool SweepSample(uint32 Index, const FVector &SweepEnd, float LineLength);
+	bool ReuseContact(uint32 Index, const FVector &SweepEnd, float LineLength, bool IgnoreThresholds = false);
+	void FetchBodyState();
+	void PlanRings(float DeltaTime);
+	// Resizes the samples for a new LOD, from PrepareSubstep only
+	void ApplyLOD(ETireLOD NewLOD);
+	// Roughens the gathered lanes' compression and normals, after the gather and before the kernel
+	void ApplySurfaceRoughness();
+
+	// Rebuilds the response tables at the next PrepareSubstep, call after editing the curves at runtime.
+	// New curve assets, WheelTirePressurePower, WheelTirePressurePreload and SlipCurveRange are picked up without it.
+	UFUNCTION(BlueprintCallable)
+	void BakeResponseCurves();
+	// Rebuilds the response tables now, from InitializeSamples and PrepareSubstep only
+	void BakeResponseTables();
+	bool ResponseInputsChanged() const;
+
+	void ConfigureSamples(int32 ToroidalDensity);
+	// Any thread, resamples the tire at the next PrepareSubstep
+	void SetLOD(ETireLOD NewLOD);
+	// Negative ViewDistance when the world has no view
+	ETireLOD GetDesiredLOD(float ViewDistance) const;
+	// Estimated sweeps per substep
+	int32 GetLODSweepCost(ETireLOD InLOD) const;
+	void ApplyForces(float TotalHitWeight);
+
+	static void ComputeLaneForcesVectorized(FTireForceLanes &Lanes, const FTireKernelParams &Params);
 
 	int32 GetDebugData(FString Key);
 	void SetDebugData(FString Key, int32 Value);
@@ -70,10 +280,49 @@ public:
 	UStaticMeshComponent* WheelMesh;
 	FVector WheelTransformedLocation;
 	UTextRenderComponent* TextRender;
-	FString CompositedText;
 	uint32 SubstepIndex;
+	float SubstepHitWeight = 0;
+
+	// Sample count of the Full LOD, every LOD scales its springs against it
+	float ReferenceTraceDensity = 1;
+	float SampleWeightScale = 1;
+	// Share of the full resolution samples in contact, smoothed
+	float ContactFraction = .05;
+	FVector SingleSweepDirection = -FVector::UpVector;
 
-	TArray<FTireImpact> TireImpacts;
+	FVector LastNetForce = FVector::ZeroVector;
+	FVector LastNetTorque = FVector::ZeroVector;
+	FVector LODBlendForce = FVector::ZeroVector;
+	FVector LODBlendTorque = FVector::ZeroVector;
+	int32 LODBlendRemaining = 0;
+	// Set by SetLOD, applied on the physics thread between substeps
+	FThreadSafeCounter PendingLOD;
+
+	TSharedPtr<class FAdvancedWheelManager, ESPMode::ThreadSafe> Manager;
+
+	FTireSampleStreams Samples;
+	FTireRoughnessBatch Roughness;
+	FTireForceLanes Lanes;
+	FTireBodyState BodyState;
+	// EnginePower and BreakPower of the running substep, latched by PrepareSubstep or read from the replay
+	float SubstepEnginePower = 0;
+	float SubstepBreakPower = 0;
+	// Used instead of the world when set
+	const ITireGroundQuery *GroundQuery = nullptr;
+
+	FTireResponseTable PressureTable;
+	FTireResponseTable GripTable;
+	FTireResponseTable SlipTable;
+	// Set by BakeResponseCurves, baked on the physics thread between substeps
+	FThreadSafeBool PendingBake;
+	// What the tables were baked from
+	const class UCurveFloat *BakedPressureCurve = nullptr;
+	const class UCurveFloat *BakedGripCurve = nullptr;
+	const class UCurveFloat *BakedSlipFrictionCurve = nullptr;
+	float BakedPressurePower = 0;
+	float BakedPressurePreload = 0;
+	float BakedSlipCurveRange = 0;
+	FCollisionQueryParams HitParams;
 
 	bool Crashed = false;
 
@@ -83,6 +332,26 @@ public:
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
 		TMap <FString, int32> DebugData;
 
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+		FWheelSubstepStats Stats;
+	// Accumulated by the substeps, moved to Stats on the next tick
+	FWheelSubstepStats PendingStats;
+
+	// Written by the physics callback once per substep, drained by the game thread and the capture writer
+	FTireTelemetryRing Telemetry;
+	FTireTelemetryRecord PendingRecord;
+	TUniquePtr<FTireTelemetryWriter> TelemetryWriter;
+	uint64 TelemetryCursor = 0;
+	TArray<FTireTelemetryRecord> TelemetryRecords;
+
+	FTireReplay Replay;
+	int32 ReplayFrame = 0;
+
+	FDebugFloatHistory SpringHistory;
+	FDebugFloatHistory DampHistory;
+	FDebugFloatHistory FrictionHistory;
+	FTireDebugBatch DebugBatch;
+
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 		float EnginePower;
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
@@ -97,10 +366,96 @@ public:
 		bool DebugDraws = false;
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 		bool DrawTraceSpheres = false;
+	// Draw every Nth sample
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "1"))
+		int32 DebugDrawStride = 1;
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 		bool DebugLogs = false;
+	// Streams every substep's telemetry to Saved/Telemetry/<TelemetryFile>_<wheel>_<time>.ttel from a background thread
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+		bool TelemetryCapture = false;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (EditCondition = "TelemetryCapture"))
+		FString TelemetryFile = TEXT("TireTelemetry");
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+		ETireReplayMode ReplayMode = ETireReplayMode::None;
+	// Relative to Saved/Replays, each wheel uses <ReplayFile>_<WheelComponentName>.trlp, which TireBench -replay= reads as well
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+		FString ReplayFile = TEXT("TireReplay");
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 		bool OptimizedTracing = true;
+	// Runs the per-sample force math 4 samples at a time, the scalar path is kept as reference
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+		bool VectorizedForceKernel = true;
+	// Simulated by the world's FAdvancedWheelManager alongside every other batched wheel
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+		bool BatchedSimulation = false;
+	// Re-projects last substep's hits on their contact plane instead of sweeping again while the sample barely moved
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+		bool ContactReuse = false;
+	// Sample motion since its last sweep, in SphereTraceRadius units, past which it is swept again
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (EditCondition = "ContactReuse"))
+		float ContactReuseMotionThreshold = 0.5;
+	// Predicted compression change past which the sample is swept again
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (EditCondition = "ContactReuse"))
+		float ContactReusePenetrationThreshold = 0.1;
+	// Substeps a contact can be reused before a forced sweep
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (EditCondition = "ContactReuse", ClampMin = "1", ClampMax = "254"))
+		int32 ContactReuseMaxAge = 4;
+
+	// Traces densely only around the contact arc predicted from last substep's hits
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+		bool AdaptiveSampling = false;
+	// Upper bound on sweeps per substep
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (EditCondition = "AdaptiveSampling", ClampMin = "1"))
+		int32 AdaptiveSampleBudget = 600;
+	// Extra rings traced densely on both sides of the predicted arc
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (EditCondition = "AdaptiveSampling", ClampMin = "0"))
+		int32 AdaptiveArcMargin = 2;
+	// One ring traced every stride outside the arc, 0 skips them
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (EditCondition = "AdaptiveSampling", ClampMin = "0", ClampMax = "255"))
+		int32 AdaptiveSparseStride = 5;
+
+	// Offsets the compression and tilts the normal of every hit sample by noise at its contact, so coarse collision still feels textured.
+	// Torus LODs only, the single sweep ones would shake the whole wheel.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+		bool SurfaceRoughness = false;
+	// Roughness of the hit's physical material, SurfaceRoughnessDefault for the others
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (EditCondition = "SurfaceRoughness"))
+		TMap<UPhysicalMaterial*, FTireSurfaceRoughness> SurfaceRoughnessMaterials;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (EditCondition = "SurfaceRoughness"))
+		FTireSurfaceRoughness SurfaceRoughnessDefault;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (EditCondition = "SurfaceRoughness", ClampMin = "1", ClampMax = "8"))
+		int32 SurfaceRoughnessLevels = 3;
+
+	// Steps the tire model down with distance to the closest local player view, see venine.Wheel.SweepBudget for the world budget
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+		bool EnableLOD = false;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+		ETireLOD LOD = ETireLOD::Full;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (EditCondition = "EnableLOD"))
+		float LODReducedDistance = 2000;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (EditCondition = "EnableLOD"))
+		float LODSingleSweepDistance = 5000;
+	// Also used for wheels off screen
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (EditCondition = "EnableLOD"))
+		float LODKinematicDistance = 15000;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (EditCondition = "EnableLOD", ClampMin = "0.1", ClampMax = "1"))
+		float LODReducedDensityScale = .5;
+	// Substeps over which the wrench of the previous LOD fades out
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (EditCondition = "EnableLOD", ClampMin = "0"))
+		int32 LODBlendSubsteps = 8;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+		ETireSpringIntegration SpringIntegration = ETireSpringIntegration::Explicit;
+	// Mass the tire springs hold up in SemiImplicit, 0 uses the wheel body's mass
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0"))
+		float SemiImplicitSprungMass = 0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+		ETireForceApplication ForceApplication = ETireForceApplication::NetWrench;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "1", ClampMax = "16"))
+		int32 ContactPatchCount = 4;
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 		float WheelTireInnerRadius = 25;
@@ -109,6 +464,9 @@ public:
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 		int32 WheelToroidalDensity = 50;
+	// WheelToroidalDensity of the current LOD
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+		int32 ActiveToroidalDensity;
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
 		int32 WheelPoloidalDensity;
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
@@ -137,4 +495,19 @@ public:
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 		float WheelTireFrictionDeltaMax = 20000.;
+
+	// Reads pressure, grip and slip friction from tables baked out of the curves below
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+		bool TabulatedResponse = true;
+	// Compression to pressure, preload included. Unset uses WheelTirePressurePower and WheelTirePressurePreload
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta = (EditCondition = "TabulatedResponse"))
+		class UCurveFloat *PressureCurve = nullptr;
+	// Compression to grip strength. Unset uses the 1 - (1 - C)^5 falloff
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta = (EditCondition = "TabulatedResponse"))
+		class UCurveFloat *GripCurve = nullptr;
+	// Lateral slip speed to friction scale, over [0, SlipCurveRange]. Unset keeps friction linear
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta = (EditCondition = "TabulatedResponse"))
+		class UCurveFloat *SlipFrictionCurve = nullptr;
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta = (EditCondition = "TabulatedResponse", ClampMin = "1"))
+		float SlipCurveRange = 2000;
 };
\ No newline at end of file
@@ -0,0 +1,167 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "AdvancedWheelManager.h"
+#include "AdvancedWheelComponent.h"
+#include "Venine.h"
+#include "Async/ParallelFor.h"
+#include "Engine/LocalPlayer.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("Manager Substep"), STAT_WheelManagerSubstep, STATGROUP_AdvancedWheel);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Batched Wheels"), STAT_WheelManagerWheels, STATGROUP_AdvancedWheel);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Budgeted Sweeps"), STAT_WheelManagerSweeps, STATGROUP_AdvancedWheel);
+
+static TAutoConsoleVariable<int32> CVarWheelSweepBudget(
+	TEXT("venine.Wheel.SweepBudget"),
+	0,
+	TEXT("Estimated sweeps per substep allowed across every LOD enabled wheel of the world, farthest wheels are demoted first.\n")
+	TEXT("0: unlimited"));
+
+TMap<UWorld*, TWeakPtr<FAdvancedWheelManager, ESPMode::ThreadSafe>> FAdvancedWheelManager::Managers;
+
+TSharedPtr<FAdvancedWheelManager, ESPMode::ThreadSafe> FAdvancedWheelManager::Get(UWorld *World)
+{
+	TSharedPtr<FAdvancedWheelManager, ESPMode::ThreadSafe> Manager = Managers.FindRef(World).Pin();
+
+	if (!Manager.IsValid()) {
+		Manager = MakeShareable(new FAdvancedWheelManager(World));
+		Managers.Add(World, Manager);
+
+		// Weak binding, a callback queued before the last wheel unregistered pins the manager or is skipped
+		Manager->OnCalculateCustomPhysics.BindThreadSafeSP(Manager.ToSharedRef(), &FAdvancedWheelManager::SubstepTick);
+	}
+
+	return Manager;
+}
+
+FAdvancedWheelManager::FAdvancedWheelManager(UWorld *InWorld)
+	: World(InWorld)
+{
+}
+
+void FAdvancedWheelManager::Register(UAdvancedWheelComponent *Wheel)
+{
+	Wheels.AddUnique(Wheel);
+	ActiveWheels.Reserve(Wheels.Num());
+}
+
+void FAdvancedWheelManager::Unregister(UAdvancedWheelComponent *Wheel)
+{
+	Wheels.Remove(Wheel);
+
+	if (Wheels.Num() == 0) {
+		for (auto It = Managers.CreateIterator(); It; ++It) {
+			if (!It.Value().IsValid() || It.Value().Pin().Get() == this) {
+				It.RemoveCurrent();
+			}
+		}
+	}
+}
+
+void FAdvancedWheelManager::QueueSubsteps(FBodyInstance *BodyInstance)
+{
+	// Any simulated body works, the callback runs once per substep whoever carries it.
+	// AddCustomPhysics drops callbacks on kinematic and non simulating bodies, leave the frame to the next wheel.
+	if (QueuedFrame != GFrameCounter && BodyInstance->IsInstanceSimulatingPhysics()) {
+		QueuedFrame = GFrameCounter;
+		BodyInstance->AddCustomPhysics(OnCalculateCustomPhysics);
+	}
+}
+
+void FAdvancedWheelManager::UpdateLODs()
+{
+	if (LODFrame == GFrameCounter) {
+		return;
+	}
+	LODFrame = GFrameCounter;
+
+	TArray<FVector, TInlineAllocator<4>> Views;
+	for (FConstPlayerControllerIterator It = World->GetPlayerControllerIterator(); It; ++It) {
+		APlayerController *Controller = It->Get();
+		if (Controller && Controller->IsLocalController()) {
+			FVector Location;
+			FRotator Rotation;
+			Controller->GetPlayerViewPoint(Location, Rotation);
+			Views.Add(Location);
+		}
+	}
+
+	struct FWheelLOD
+	{
+		UAdvancedWheelComponent *Wheel;
+		float Distance;
+		ETireLOD LOD;
+	};
+
+	TArray<FWheelLOD, TInlineAllocator<16>> Desired;
+	int32 Sweeps = 0;
+
+	for (UAdvancedWheelComponent *Wheel : Wheels) {
+		if (!Wheel->WheelMesh) continue;
+
+		// Dedicated servers have no view, GetDesiredLOD keeps them at full resolution
+		float Distance = -1;
+		if (Views.Num() > 0) {
+			Distance = MAX_flt;
+			for (const FVector &View : Views) {
+				Distance = FMath::Min(Distance, FVector::Dist(View, Wheel->WheelMesh->GetComponentLocation()));
+			}
+		}
+
+		const ETireLOD LOD = Wheel->GetDesiredLOD(Distance);
+		Desired.Add({ Wheel, Distance, LOD });
+		Sweeps += Wheel->GetLODSweepCost(LOD);
+	}
+
+	const int32 Budget = CVarWheelSweepBudget.GetValueOnGameThread();
+	if (Budget > 0 && Sweeps > Budget) {
+		Desired.Sort([](const FWheelLOD &A, const FWheelLOD &B) { return A.Distance > B.Distance; });
+
+		// Demote one level at a time from the farthest wheel until the estimate fits
+		bool Demoted = true;
+		while (Sweeps > Budget && Demoted) {
+			Demoted = false;
+			for (FWheelLOD &Entry : Desired) {
+				if (!Entry.Wheel->EnableLOD || Entry.LOD == ETireLOD::Kinematic) continue;
+
+				const ETireLOD Next = (ETireLOD)((uint8)Entry.LOD + 1);
+				Sweeps += Entry.Wheel->GetLODSweepCost(Next) - Entry.Wheel->GetLODSweepCost(Entry.LOD);
+				Entry.LOD = Next;
+				Demoted = true;
+				break;
+			}
+		}
+	}
+
+	INC_DWORD_STAT_BY(STAT_WheelManagerSweeps, Sweeps);
+
+	for (const FWheelLOD &Entry : Desired) {
+		Entry.Wheel->SetLOD(Entry.LOD);
+	}
+}
+
+void FAdvancedWheelManager::SubstepTick(float DeltaTime, FBodyInstance *BodyInstance)
+{
+	SCOPE_CYCLE_COUNTER(STAT_WheelManagerSubstep);
+
+	// Gather transforms and body state, PhysX reads stay on this thread
+	ActiveWheels.Reset();
+	for (UAdvancedWheelComponent *Wheel : Wheels) {
+		if (Wheel->BatchedSimulation && Wheel->PrepareSubstep()) {
+			ActiveWheels.Add(Wheel);
+		}
+	}
+
+	INC_DWORD_STAT_BY(STAT_WheelManagerWheels, ActiveWheels.Num());
+
+	// Scene queries and force kernels of every wheel at once, debug lines go to each wheel's own batch
+	ParallelFor(ActiveWheels.Num(), [this, DeltaTime](int32 Index) {
+		ActiveWheels[Index]->ComputeSubstep(DeltaTime);
+	}, ActiveWheels.Num() < 2);
+
+	// PhysX writes stay on this thread
+	for (UAdvancedWheelComponent *Wheel : ActiveWheels) {
+		Wheel->ApplySubstep();
+	}
+}
@@ -0,0 +1,49 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "PhysicsEngine/BodyInstance.h"
+
+class UAdvancedWheelComponent;
+
+/**
+ * Owns every UAdvancedWheelComponent of a world, picks their LOD against the world sweep budget
+ * and simulates the batched ones from one custom physics callback per substep.
+ * Body state is gathered serially, traces and force kernels run in parallel across wheels, forces are applied serially.
+ */
+class VENINE_API FAdvancedWheelManager : public TSharedFromThis<FAdvancedWheelManager, ESPMode::ThreadSafe>
+{
+public:
+
+	// Shared by every wheel of the world, released with the last one or after the last queued substep callback
+	static TSharedPtr<FAdvancedWheelManager, ESPMode::ThreadSafe> Get(UWorld *World);
+
+	FAdvancedWheelManager(UWorld *InWorld);
+
+	void Register(UAdvancedWheelComponent *Wheel);
+	void Unregister(UAdvancedWheelComponent *Wheel);
+
+	// Called from every wheel tick, the first call of a frame with a simulating body queues the substep callback
+	void QueueSubsteps(FBodyInstance *BodyInstance);
+
+	// Called from every wheel tick, only the first call of a frame assigns LODs
+	void UpdateLODs();
+
+	const TArray<UAdvancedWheelComponent*> &GetWheels() const { return Wheels; }
+
+private:
+
+	void SubstepTick(float DeltaTime, FBodyInstance *BodyInstance);
+
+	static TMap<UWorld*, TWeakPtr<FAdvancedWheelManager, ESPMode::ThreadSafe>> Managers;
+
+	TArray<UAdvancedWheelComponent*> Wheels;
+	TArray<UAdvancedWheelComponent*> ActiveWheels;
+
+	UWorld *World;
+
+	FCalculateCustomPhysics OnCalculateCustomPhysics;
+	uint64 QueuedFrame = MAX_uint64;
+	uint64 LODFrame = MAX_uint64;
+};
@@ -0,0 +1,346 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "NoiseBenchCommandlet.h"
+#include "SimplexNoise.h"
+#include "NoiseVolumeCache.h"
+#include "Venine.h"
+#include "HAL/PlatformTime.h"
+#include "Math/RandomStream.h"
+#include "Misc/FileHelper.h"
+
+#define LOG(format, ...) UE_LOG(LogTemp, Log, TEXT(format), __VA_ARGS__)
+#define LOGW(format, ...) UE_LOG(LogTemp, Warning, TEXT(format), __VA_ARGS__)
+#define LOGE(format, ...) UE_LOG(LogTemp, Error, TEXT(format), __VA_ARGS__)
+
+/************ FIELDS ************/
+
+// Positions in lattice units, uniform in -1000..1000 on every axis
+static void MakePositions(int32 Samples, TArray<FVector4> &Positions)
+{
+	FRandomStream Stream(1337);
+	Positions.SetNumUninitialized(Samples);
+	for (FVector4 &Position : Positions) {
+		Position.X = Stream.FRandRange(-1000, 1000);
+		Position.Y = Stream.FRandRange(-1000, 1000);
+		Position.Z = Stream.FRandRange(-1000, 1000);
+		Position.W = Stream.FRandRange(-1000, 1000);
+	}
+}
+
+static const FVector4 GoldenPositions[8] =
+{
+	FVector4(0.1f, 0.2f, 0.3f, 0.4f), FVector4(-3.7f, 12.25f, 5.5f, -1.25f), FVector4(123.4f, -56.7f, 89.1f, 2.5f), FVector4(-1000.5f, 2000.25f, -3000.75f, 7.125f),
+	FVector4(0.5f, 0.5f, 0.5f, 0.5f), FVector4(17.3f, 0.f, -8.9f, 100.2f), FVector4(4096.1f, -8192.2f, 16.3f, -64.4f), FVector4(-0.9f, -0.8f, -0.7f, -0.6f),
+};
+
+// One noise field, its expected behaviour is that of the reference implementation
+struct FNoiseBenchField {
+	const TCHAR *Name;
+	int32 Dimensions;
+	// A lattice step of L along the first axis moves a position by L on it and by -L * UnSkew on every axis
+	float UnSkew;
+	TFunction<float(const FVector4 &Position, bool bTurbulence, int32 Levels)> Evaluate;
+
+	// Single octave mean, standard deviation and largest magnitude
+	float Mean;
+	float StdDev;
+	float MaxAbs;
+	// Smallest power of two lattice step, from 1, past which the field correlates above .9 with itself, 0 for none up to MaxPeriod
+	int32 Period;
+	// Single octave, then six turbulent levels, at GoldenPositions
+	float Golden[2][8];
+};
+
+static const int32 MaxPeriod = 32768;
+
+static const TArray<FNoiseBenchField> &GetFields()
+{
+	static const TArray<FNoiseBenchField> Fields =
+	{
+		// The table wraps every 128 lattice points
+		{ TEXT("2D"), 2, 0.211324865f, [](const FVector4 &P, bool bTurbulence, int32 Levels) { return USimplexNoise::SimplexNoise2D(FVector2D(P.X, P.Y), 1, bTurbulence, Levels); },
+			0.f, .439f, .998f, 128,
+			{ { 0.2785214f, -0.1945848f, -0.2993536f, 0.6686785f, -0.3276336f, 0.3022339f, 0.0109022f, 0.4909127f },
+			{ -0.0261366f, 0.1734678f, 0.1511511f, 0.7020582f, 0.2607083f, -0.0397622f, -0.1605510f, 0.7216842f } } },
+		// Texels are addressed per 128 lattice points, neighbouring points mostly share their gradient:
+		// the field correlates .99 with itself one lattice step away and only decorrelates past 64
+		{ TEXT("3D"), 3, 1.f / 6.f, [](const FVector4 &P, bool bTurbulence, int32 Levels) { return USimplexNoise::SimplexNoise(FVector(P), 1, bTurbulence, Levels); },
+			0.f, .384f, 1.672f, 1,
+			{ { 0.1974652f, 0.6228919f, 0.4146276f, 0.3149085f, 0.0000000f, -0.1108625f, 0.2384896f, 0.7514759f },
+			{ -0.0566292f, 0.7369809f, 0.4030298f, -0.2983521f, -1.0000000f, -0.5632262f, -0.2604391f, 1.3945994f } } },
+		{ TEXT("4D"), 4, 0.138196601f, [](const FVector4 &P, bool bTurbulence, int32 Levels) { return USimplexNoise::SimplexNoise4D(FVector(P), P.W, 1, bTurbulence, Levels); },
+			0.f, .280f, .982f, 128,
+			{ { -0.3039001f, 0.0488862f, 0.2890817f, -0.4832430f, 0.1827874f, -0.4545237f, -0.1769583f, -0.0732070f },
+			{ -0.1774083f, -0.2998850f, -0.3032523f, 0.6052086f, -0.2309715f, 0.1114025f, -0.3110368f, -0.5697089f } } },
+		{ TEXT("3D#1"), 3, 1.f / 6.f, [](const FVector4 &P, bool bTurbulence, int32 Levels) { return USimplexNoise::SimplexNoiseSeeded(FVector(P), 1, 1, bTurbulence, Levels); },
+			0.f, .425f, 1.656f, 0,
+			{ { 0.5396769f, 0.8029368f, 0.7102931f, -0.3187925f, 0.0000000f, -0.5813712f, -0.7434270f, -0.0837657f },
+			{ 0.9216586f, 1.5718613f, 1.1457498f, -0.2822359f, -1.0000000f, 0.9533541f, 0.7439260f, 0.0607861f } } },
+	};
+	return Fields;
+}
+
+/************ BENCH ************/
+
+// Best of Repeats, in ns per sample
+static double TimeSamples(int32 Samples, int32 Repeats, const TFunction<void()> &Run)
+{
+	uint64 Best = MAX_uint64;
+	for (int32 Repeat = 0; Repeat < Repeats; Repeat++) {
+		const uint64 StartCycles = FPlatformTime::Cycles64();
+		Run();
+		Best = FMath::Min(Best, FPlatformTime::Cycles64() - StartCycles);
+	}
+	return FPlatformTime::ToSeconds64(Best) * 1e9 / Samples;
+}
+
+void UNoiseBenchCommandlet::RunBench(const FString &Params, int32 Samples)
+{
+	FString LevelList = TEXT("1,4,8");
+	int32 Repeats = 5;
+	FParse::Value(*Params, TEXT("levels="), LevelList);
+	FParse::Value(*Params, TEXT("repeats="), Repeats);
+
+	TArray<FString> LevelNames;
+	LevelList.ParseIntoArray(LevelNames, TEXT(","));
+
+	// World positions, a few hundred lattice points across at this scale
+	const float Scale = .05f;
+	TArray<FVector4> Positions;
+	MakePositions(Samples, Positions);
+
+	TArray<FVector> Positions3D;
+	TArray<float> X, Y, Z, Values;
+	Positions3D.SetNumUninitialized(Samples);
+	X.SetNumUninitialized(Samples);
+	Y.SetNumUninitialized(Samples);
+	Z.SetNumUninitialized(Samples);
+	Values.SetNumUninitialized(Samples);
+	for (int32 Index = 0; Index < Samples; Index++) {
+		Positions3D[Index] = FVector(Positions[Index]);
+		X[Index] = Positions[Index].X;
+		Y[Index] = Positions[Index].Y;
+		Z[Index] = Positions[Index].Z;
+	}
+
+	FNoiseVolumeCache &Cache = FNoiseVolumeCache::Get();
+
+	for (const FString &LevelName : LevelNames) {
+		const int32 Levels = FCString::Atoi(*LevelName);
+
+		auto Report = [&](int32 Dimensions, const TCHAR *Mode, const TCHAR *Path, const TFunction<void()> &Run) {
+			LOG("NoiseBench %dD %-6s %-12s levels=%d: %8.1f ns/sample", Dimensions, Mode, Path, Levels, TimeSamples(Samples, Repeats, Run));
+		};
+
+		Report(2, TEXT("table"), TEXT("scalar"), [&]() {
+			for (int32 Index = 0; Index < Samples; Index++) Values[Index] = USimplexNoise::SimplexNoise2D(FVector2D(X[Index], Y[Index]), Scale, true, Levels);
+		});
+
+		Report(3, TEXT("table"), TEXT("scalar"), [&]() {
+			for (int32 Index = 0; Index < Samples; Index++) Values[Index] = USimplexNoise::SimplexNoise(Positions3D[Index], Scale, true, Levels);
+		});
+		Report(3, TEXT("table"), TEXT("kernel"), [&]() {
+			const USimplexNoise::FNoiseKernel Kernel = USimplexNoise::GetNoiseKernel(true, Levels, 0.f);
+			for (int32 Index = 0; Index < Samples; Index++) Values[Index] = Kernel(Positions3D[Index], Scale, Levels, -1.f, 1.f, 2.f, 0.f);
+		});
+		Report(3, TEXT("table"), TEXT("batch"), [&]() {
+			USimplexNoise::SimplexNoiseBatch(Positions3D, Values, Scale, true, Levels);
+		});
+		Report(3, TEXT("table"), TEXT("soa"), [&]() {
+			USimplexNoise::SimplexNoiseSoA(X.GetData(), Y.GetData(), Z.GetData(), Values.GetData(), Samples, Scale, true, Levels);
+		});
+		Report(3, TEXT("table"), TEXT("soa parallel"), [&]() {
+			USimplexNoise::SimplexNoiseSoAParallel(X.GetData(), Y.GetData(), Z.GetData(), Values.GetData(), Samples, Scale, true, Levels);
+		});
+
+		// Every tile generated beforehand, only lookups are measured
+		FNoiseVolumeSettings Settings;
+		Settings.Scale = Scale;
+		Settings.Levels = Levels;
+		Cache.Prefetch(Cache.FindOrAddVolume(Settings), FBox(FVector(-1000), FVector(1000)));
+		Cache.Flush();
+		const FNoiseVolumeCache::FStats Before = Cache.GetStats();
+		Report(3, TEXT("table"), TEXT("cached"), [&]() {
+			for (int32 Index = 0; Index < Samples; Index++) Values[Index] = USimplexNoise::SimplexNoiseCached(Positions3D[Index], Settings.VoxelSize, Scale, true, Levels);
+		});
+		const FNoiseVolumeCache::FStats After = Cache.GetStats();
+		const int64 Lookups = (After.Hits - Before.Hits) + (After.Misses - Before.Misses);
+		LOG("NoiseBench 3D table cached      levels=%d: %.1f%% hits over %d tiles", Levels, Lookups > 0 ? 100. * (After.Hits - Before.Hits) / Lookups : 0., After.Tiles);
+
+		Report(3, TEXT("seeded"), TEXT("scalar"), [&]() {
+			for (int32 Index = 0; Index < Samples; Index++) Values[Index] = USimplexNoise::SimplexNoiseSeeded(Positions3D[Index], 1, Scale, true, Levels);
+		});
+		Report(3, TEXT("seeded"), TEXT("soa"), [&]() {
+			USimplexNoise::SimplexNoiseSeededSoA(X.GetData(), Y.GetData(), Z.GetData(), Values.GetData(), Samples, 1, Scale, true, Levels);
+		});
+		Report(3, TEXT("seeded"), TEXT("soa parallel"), [&]() {
+			USimplexNoise::SimplexNoiseSeededSoAParallel(X.GetData(), Y.GetData(), Z.GetData(), Values.GetData(), Samples, 1, Scale, true, Levels);
+		});
+
+		Report(4, TEXT("table"), TEXT("scalar"), [&]() {
+			for (int32 Index = 0; Index < Samples; Index++) Values[Index] = USimplexNoise::SimplexNoise4D(Positions3D[Index], Positions[Index].W, Scale, true, Levels);
+		});
+	}
+
+	Cache.Empty();
+}
+
+/************ QUALITY ************/
+
+int32 UNoiseBenchCommandlet::RunQuality(const FString &Params, int32 Samples)
+{
+	float Tolerance = 1e-4f;
+	FParse::Value(*Params, TEXT("tolerance="), Tolerance);
+
+	TArray<FVector4> Positions;
+	MakePositions(Samples, Positions);
+
+	const TArray<FNoiseBenchField> &Fields = GetFields();
+	int32 Failures = 0;
+
+	auto Check = [&](bool bPassed, const FString &What) {
+		if (!bPassed) {
+			LOGE("NoiseBench quality: %s", *What);
+			Failures++;
+		}
+	};
+
+	// Single octave, then six turbulent levels, of every field at every position
+	TArray<float> Values;
+	Values.SetNumUninitialized(Fields.Num() * 2 * Samples);
+
+	for (int32 FieldIndex = 0; FieldIndex < Fields.Num(); FieldIndex++) {
+		const FNoiseBenchField &Field = Fields[FieldIndex];
+
+		for (int32 Fractal = 0; Fractal < 2; Fractal++) {
+			float *FieldValues = Values.GetData() + (FieldIndex * 2 + Fractal) * Samples;
+
+			double Sum = 0, SumSquared = 0;
+			float Min = MAX_flt, Max = -MAX_flt;
+			int32 NonFinite = 0;
+			for (int32 Index = 0; Index < Samples; Index++) {
+				const float Value = Field.Evaluate(Positions[Index], Fractal == 1, Fractal ? 6 : 1);
+				FieldValues[Index] = Value;
+				if (!FMath::IsFinite(Value)) {
+					NonFinite++;
+					continue;
+				}
+				Sum += Value;
+				SumSquared += Value * Value;
+				Min = FMath::Min(Min, Value);
+				Max = FMath::Max(Max, Value);
+			}
+			const double Mean = Sum / Samples;
+			const double StdDev = FMath::Sqrt(FMath::Max(SumSquared / Samples - Mean * Mean, 0.));
+
+			LOG("NoiseBench %-4s %s: min %.4f max %.4f mean %.4f deviation %.4f", Field.Name, Fractal ? TEXT("6 turbulent levels") : TEXT("1 level"), Min, Max, Mean, StdDev);
+
+			Check(NonFinite == 0, FString::Printf(TEXT("%s has %d non finite values"), Field.Name, NonFinite));
+			if (!Fractal) {
+				Check(FMath::Max(-Min, Max) <= Field.MaxAbs * 1.05f, FString::Printf(TEXT("%s reaches %.4f, reference %.4f"), Field.Name, FMath::Max(-Min, Max), Field.MaxAbs));
+				Check(FMath::Abs(Mean - Field.Mean) <= .02, FString::Printf(TEXT("%s mean %.4f, reference %.4f"), Field.Name, Mean, Field.Mean));
+				Check(FMath::Abs(StdDev / Field.StdDev - 1) <= .1, FString::Printf(TEXT("%s deviation %.4f, reference %.4f"), Field.Name, StdDev, Field.StdDev));
+			}
+
+			for (int32 Golden = 0; Golden < ARRAY_COUNT(GoldenPositions); Golden++) {
+				const float Value = Field.Evaluate(GoldenPositions[Golden], Fractal == 1, Fractal ? 6 : 1);
+				Check(FMath::Abs(Value - Field.Golden[Fractal][Golden]) <= Tolerance,
+					FString::Printf(TEXT("%s at %s is %.7f, reference %.7f"), Field.Name, *GoldenPositions[Golden].ToString(), Value, Field.Golden[Fractal][Golden]));
+			}
+		}
+
+		// Correlation between positions a power of two lattice steps apart, near 1 where the field tiles
+		const int32 PeriodSamples = FMath::Min(Samples, 2048);
+		int32 Period = 0;
+		FString Correlations;
+		for (int32 Step = 1; Step <= MaxPeriod; Step *= 2) {
+			FVector4 Offset(-Step * Field.UnSkew, -Step * Field.UnSkew, -Step * Field.UnSkew, -Step * Field.UnSkew);
+			Offset.X += Step;
+
+			double SumA = 0, SumB = 0, SumAB = 0, SumAA = 0, SumBB = 0;
+			for (int32 Index = 0; Index < PeriodSamples; Index++) {
+				const double A = Field.Evaluate(Positions[Index], false, 1);
+				const double B = Field.Evaluate(Positions[Index] + Offset, false, 1);
+				SumA += A;
+				SumB += B;
+				SumAB += A * B;
+				SumAA += A * A;
+				SumBB += B * B;
+			}
+			const double Covariance = SumAB / PeriodSamples - SumA * SumB / ((double)PeriodSamples * PeriodSamples);
+			const double VarianceA = SumAA / PeriodSamples - FMath::Square(SumA / PeriodSamples);
+			const double VarianceB = SumBB / PeriodSamples - FMath::Square(SumB / PeriodSamples);
+			const double Correlation = Covariance / FMath::Sqrt(FMath::Max(VarianceA * VarianceB, (double)SMALL_NUMBER));
+
+			Correlations += FString::Printf(TEXT(" %d:%.2f"), Step, Correlation);
+			if (Period == 0 && Correlation > .9) {
+				Period = Step;
+			}
+		}
+
+		LOG("NoiseBench %-4s lattice step correlation%s", Field.Name, *Correlations);
+		Check(Period == Field.Period, FString::Printf(TEXT("%s repeats every %d lattice steps, reference %d"), Field.Name, Period, Field.Period));
+	}
+
+	// Whole sample set against a previous run
+	FString ReferenceFile;
+	if (FParse::Value(*Params, TEXT("reference="), ReferenceFile)) {
+		TArray<uint8> Bytes;
+		if (!FFileHelper::LoadFileToArray(Bytes, *ReferenceFile) || Bytes.Num() != Values.Num() * sizeof(float)) {
+			LOGE("NoiseBench: couldn't read %s, or it was written with another sample count", *ReferenceFile);
+			Failures++;
+		} else {
+			const float *Reference = (const float *)Bytes.GetData();
+			for (int32 FieldIndex = 0; FieldIndex < Fields.Num(); FieldIndex++) {
+				for (int32 Fractal = 0; Fractal < 2; Fractal++) {
+					const int32 First = (FieldIndex * 2 + Fractal) * Samples;
+					float MaxError = 0;
+					int32 Mismatches = 0;
+					for (int32 Index = First; Index < First + Samples; Index++) {
+						const float Error = FMath::Abs(Values[Index] - Reference[Index]);
+						MaxError = FMath::Max(MaxError, Error);
+						Mismatches += !(Error <= Tolerance);
+					}
+					LOG("NoiseBench %-4s %s against %s: max error %g, %d above %g", Fields[FieldIndex].Name, Fractal ? TEXT("6 turbulent levels") : TEXT("1 level"), *ReferenceFile, MaxError, Mismatches, Tolerance);
+					Check(Mismatches == 0, FString::Printf(TEXT("%s differs from %s at %d positions"), Fields[FieldIndex].Name, *ReferenceFile, Mismatches));
+				}
+			}
+		}
+	}
+
+	FString WriteReferenceFile;
+	if (FParse::Value(*Params, TEXT("writereference="), WriteReferenceFile)) {
+		TArray<uint8> Bytes;
+		Bytes.Append((const uint8 *)Values.GetData(), Values.Num() * sizeof(float));
+		if (!FFileHelper::SaveArrayToFile(Bytes, *WriteReferenceFile)) {
+			LOGE("NoiseBench: couldn't write %s", *WriteReferenceFile);
+			Failures++;
+		}
+	}
+
+	LOG("NoiseBench quality: %d failed checks", Failures);
+	return Failures;
+}
+
+/*********************************/
+
+UNoiseBenchCommandlet::UNoiseBenchCommandlet()
+{
+	IsClient = false;
+	IsEditor = false;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UNoiseBenchCommandlet::Main(const FString &Params)
+{
+	int32 Samples = 65536;
+	FParse::Value(*Params, TEXT("samples="), Samples);
+	Samples = FMath::Max(Samples, 1);
+
+	if (!FParse::Param(*Params, TEXT("nobench"))) {
+		RunBench(Params, Samples);
+	}
+
+	return FParse::Param(*Params, TEXT("noquality")) ? 0 : RunQuality(Params, Samples);
+}
@@ -0,0 +1,34 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "NoiseBenchCommandlet.generated.h"
+
+/**
+ * Headless bench and quality check of USimplexNoise, returns the number of failed checks.
+ * The bench reports ns per sample for every dimension, level count, gradient mode and evaluation path.
+ * The quality pass checks range, mean and deviation, lattice periods and the values at fixed points against those of the reference implementation.
+ *
+ * UE4Editor-Cmd BikeTest.uproject -run=NoiseBench [-samples=65536] [-levels=1,4,8] [-repeats=5] [-nobench] [-noquality]
+ *     [-writereference=Saved/NoiseBench.bin] [-reference=Saved/NoiseBench.bin] [-tolerance=0.0001]
+ *
+ * -writereference saves every field at every quality sample, -reference compares against such a file, typically written before a change.
+ */
+UCLASS()
+class VENINE_API UNoiseBenchCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+
+	UNoiseBenchCommandlet();
+
+	virtual int32 Main(const FString &Params) override;
+
+private:
+
+	void RunBench(const FString &Params, int32 Samples);
+	int32 RunQuality(const FString &Params, int32 Samples);
+};
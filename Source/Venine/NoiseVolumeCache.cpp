@@ -0,0 +1,383 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "NoiseVolumeCache.h"
+#include "Venine.h"
+#include "SimplexNoise.h"
+#include "Async/Async.h"
+
+bool FNoiseVolumeSettings::operator==(const FNoiseVolumeSettings &Other) const
+{
+	return VoxelSize == Other.VoxelSize && Scale == Other.Scale && bTurbulence == Other.bTurbulence && Levels == Other.Levels
+		&& OutputMin == Other.OutputMin && OutputMax == Other.OutputMax && LevelScale == Other.LevelScale && FilterWidth == Other.FilterWidth;
+}
+
+FNoiseVolumeCache::FNoiseVolumeCache(int64 InMaxBytes) : MaxBytes(InMaxBytes)
+{
+}
+
+FNoiseVolumeCache &FNoiseVolumeCache::Get()
+{
+	static FNoiseVolumeCache Cache;
+	return Cache;
+}
+
+int32 FNoiseVolumeCache::FindOrAddVolume(const FNoiseVolumeSettings &Settings)
+{
+	FScopeLock ScopeLock(&Lock);
+	return LookupVolume(Settings);
+}
+
+int32 FNoiseVolumeCache::LookupVolume(const FNoiseVolumeSettings &InSettings)
+{
+	// Tile keys are floored from Position / VoxelSize
+	FNoiseVolumeSettings Settings = InSettings;
+	if (!ensureMsgf(Settings.VoxelSize >= MinVoxelSize, TEXT("Noise volume VoxelSize %f below %f"), Settings.VoxelSize, MinVoxelSize)) {
+		Settings.VoxelSize = MinVoxelSize;
+	}
+
+	VolumeLookups++;
+
+	int32 Volume = Volumes.IsValidIndex(LastVolume) && Volumes[LastVolume] == Settings ? LastVolume : Volumes.Find(Settings);
+	if (Volume != INDEX_NONE) {
+		VolumeLastUse[Volume] = VolumeLookups;
+		LastVolume = Volume;
+		return Volume;
+	}
+
+	if (Volumes.Num() < MaxVolumes) {
+		VolumeLastUse.Add(VolumeLookups);
+		LastVolume = Volumes.Add(Settings);
+		return LastVolume;
+	}
+
+	// Animated parameters would otherwise add a volume per frame, recycle the stalest one
+	Volume = 0;
+	for (int32 Index = 1; Index < Volumes.Num(); Index++) {
+		if (VolumeLastUse[Index] < VolumeLastUse[Volume]) {
+			Volume = Index;
+		}
+	}
+
+	RemoveVolumeTiles(Volume);
+	Volumes[Volume] = Settings;
+	VolumeLastUse[Volume] = VolumeLookups;
+	LastVolume = Volume;
+	return Volume;
+}
+
+FIntVector FNoiseVolumeCache::GetTile(const FNoiseVolumeSettings &Settings, const FVector &Position, FVector &Local) const
+{
+	const FVector Voxel = Position / Settings.VoxelSize;
+	const FIntVector Tile(FMath::FloorToInt(Voxel.X / TileSize), FMath::FloorToInt(Voxel.Y / TileSize), FMath::FloorToInt(Voxel.Z / TileSize));
+	Local = Voxel - FVector(Tile.X, Tile.Y, Tile.Z) * TileSize;
+	return Tile;
+}
+
+float FNoiseVolumeCache::Interpolate(const FTile &Tile, const FVector &Local)
+{
+	// Local is in [0, TileSize], the upper face belongs to the last cell
+	const int32 X = FMath::Clamp(FMath::FloorToInt(Local.X), 0, TileSize - 1);
+	const int32 Y = FMath::Clamp(FMath::FloorToInt(Local.Y), 0, TileSize - 1);
+	const int32 Z = FMath::Clamp(FMath::FloorToInt(Local.Z), 0, TileSize - 1);
+	const float FX = Local.X - X;
+	const float FY = Local.Y - Y;
+	const float FZ = Local.Z - Z;
+
+	const float *Samples = Tile.Samples.GetData() + (Z * TileSamples + Y) * TileSamples + X;
+	const int32 StrideY = TileSamples;
+	const int32 StrideZ = TileSamples * TileSamples;
+
+	const float X00 = FMath::Lerp(Samples[0], Samples[1], FX);
+	const float X10 = FMath::Lerp(Samples[StrideY], Samples[StrideY + 1], FX);
+	const float X01 = FMath::Lerp(Samples[StrideZ], Samples[StrideZ + 1], FX);
+	const float X11 = FMath::Lerp(Samples[StrideZ + StrideY], Samples[StrideZ + StrideY + 1], FX);
+
+	return FMath::Lerp(FMath::Lerp(X00, X10, FY), FMath::Lerp(X01, X11, FY), FZ);
+}
+
+FNoiseVolumeCache::FTile *FNoiseVolumeCache::FindOrQueueTile(int32 Volume, const FIntVector &TileCoordinates)
+{
+	const FTileKey Key = { Volume, TileCoordinates };
+
+	if (FTilePtr *Found = Tiles.Find(Key)) {
+		Touch(Found->Get());
+		// Tiles that turned ready since the last lookup can go now
+		if (Bytes > MaxBytes) {
+			EvictToBudget(MaxBytes);
+		}
+		return Found->Get();
+	}
+
+	// Pending tiles count against the budget too, past it misses are evaluated directly instead of queuing more
+	EvictToBudget(MaxBytes - TileBytes);
+	if (Bytes + TileBytes > MaxBytes) {
+		return nullptr;
+	}
+
+	FTilePtr Tile = MakeShareable(new FTile());
+	Tile->Key = Key;
+	Tiles.Add(Key, Tile);
+	Touch(Tile.Get());
+	Bytes += TileBytes;
+
+	// The task owns a reference, eviction or cache destruction never frees a tile being written
+	const FNoiseVolumeSettings Settings = Volumes[Volume];
+	Tile->Generation = Async<void>(EAsyncExecution::ThreadPool, [Tile, Settings]() {
+		const int32 Count = TileSamples * TileSamples * TileSamples;
+		const FVector Origin = FVector(Tile->Key.Tile.X, Tile->Key.Tile.Y, Tile->Key.Tile.Z) * TileSize * Settings.VoxelSize;
+
+		TArray<float> X, Y, Z;
+		X.SetNumUninitialized(Count);
+		Y.SetNumUninitialized(Count);
+		Z.SetNumUninitialized(Count);
+		int32 Index = 0;
+		for (int32 SampleZ = 0; SampleZ < TileSamples; SampleZ++) {
+			for (int32 SampleY = 0; SampleY < TileSamples; SampleY++) {
+				for (int32 SampleX = 0; SampleX < TileSamples; SampleX++, Index++) {
+					X[Index] = Origin.X + SampleX * Settings.VoxelSize;
+					Y[Index] = Origin.Y + SampleY * Settings.VoxelSize;
+					Z[Index] = Origin.Z + SampleZ * Settings.VoxelSize;
+				}
+			}
+		}
+
+		Tile->Samples.SetNumUninitialized(Count);
+		USimplexNoise::SimplexNoiseSoA(X.GetData(), Y.GetData(), Z.GetData(), Tile->Samples.GetData(), Count,
+			Settings.Scale, Settings.bTurbulence, Settings.Levels, Settings.OutputMin, Settings.OutputMax, Settings.LevelScale, Settings.FilterWidth);
+
+		Tile->Ready = true;
+	});
+
+	return Tile.Get();
+}
+
+void FNoiseVolumeCache::Touch(FTile *Tile)
+{
+	if (Tile == MostRecent) {
+		return;
+	}
+
+	if (Tile->Prev || Tile->Next || Tile == LeastRecent) {
+		Unlink(Tile);
+	}
+
+	Tile->Next = MostRecent;
+	if (MostRecent) {
+		MostRecent->Prev = Tile;
+	}
+	MostRecent = Tile;
+	if (!LeastRecent) {
+		LeastRecent = Tile;
+	}
+}
+
+void FNoiseVolumeCache::Unlink(FTile *Tile)
+{
+	if (Tile->Prev) Tile->Prev->Next = Tile->Next;
+	else MostRecent = Tile->Next;
+	if (Tile->Next) Tile->Next->Prev = Tile->Prev;
+	else LeastRecent = Tile->Prev;
+	Tile->Prev = nullptr;
+	Tile->Next = nullptr;
+}
+
+void FNoiseVolumeCache::EvictToBudget(int64 Budget)
+{
+	// Pending tiles were just asked for, only generated ones are evicted. The tile just looked up stays.
+	FTile *Tile = LeastRecent;
+	while (Bytes > Budget && Tile && Tile != MostRecent) {
+		FTile *Prev = Tile->Prev;
+		if (Tile->Ready) {
+			const FTileKey Key = Tile->Key;
+			Unlink(Tile);
+			Bytes -= TileBytes;
+			Tiles.Remove(Key);
+		}
+		Tile = Prev;
+	}
+}
+
+// Pending tiles are dropped as well, their task keeps them alive until it is done
+void FNoiseVolumeCache::RemoveVolumeTiles(int32 Volume)
+{
+	for (auto It = Tiles.CreateIterator(); It; ++It) {
+		if (It.Key().Volume == Volume) {
+			Unlink(It.Value().Get());
+			Bytes -= TileBytes;
+			It.RemoveCurrent();
+		}
+	}
+}
+
+bool FNoiseVolumeCache::TrySample(int32 Volume, const FVector &Position, float &Value)
+{
+	FScopeLock ScopeLock(&Lock);
+	return SampleTile(Volume, Position, Value);
+}
+
+bool FNoiseVolumeCache::SampleTile(int32 Volume, const FVector &Position, float &Value)
+{
+	check(Volumes.IsValidIndex(Volume));
+
+	FVector Local;
+	const FTile *Tile = FindOrQueueTile(Volume, GetTile(Volumes[Volume], Position, Local));
+
+	if (!Tile || !Tile->Ready) {
+		Misses++;
+		return false;
+	}
+
+	Hits++;
+	Value = Interpolate(*Tile, Local);
+	return true;
+}
+
+float FNoiseVolumeCache::Sample(int32 Volume, const FVector &Position)
+{
+	FNoiseVolumeSettings Settings;
+	{
+		FScopeLock ScopeLock(&Lock);
+		float Value;
+		if (SampleTile(Volume, Position, Value)) {
+			return Value;
+		}
+		Settings = Volumes[Volume];
+	}
+	return USimplexNoise::SimplexNoise(Position, Settings.Scale, Settings.bTurbulence, Settings.Levels, Settings.OutputMin, Settings.OutputMax, Settings.LevelScale, Settings.FilterWidth);
+}
+
+float FNoiseVolumeCache::Sample(const FNoiseVolumeSettings &Settings, const FVector &Position)
+{
+	{
+		FScopeLock ScopeLock(&Lock);
+		float Value;
+		if (SampleTile(LookupVolume(Settings), Position, Value)) {
+			return Value;
+		}
+	}
+	return USimplexNoise::SimplexNoise(Position, Settings.Scale, Settings.bTurbulence, Settings.Levels, Settings.OutputMin, Settings.OutputMax, Settings.LevelScale, Settings.FilterWidth);
+}
+
+void FNoiseVolumeCache::SampleBatch(int32 Volume, const TArray<FVector> &Positions, TArray<float> &Values)
+{
+	Values.SetNumUninitialized(Positions.Num());
+
+	TArray<int32> Missing;
+	TArray<FVector> MissingPositions;
+	FNoiseVolumeSettings Settings;
+
+	{
+		FScopeLock ScopeLock(&Lock);
+		check(Volumes.IsValidIndex(Volume));
+		Settings = Volumes[Volume];
+
+		// Neighbouring positions mostly share a tile
+		const FTile *Tile = nullptr;
+		FIntVector LastTile(MAX_int32);
+		bool bLooked = false;
+
+		for (int32 Index = 0; Index < Positions.Num(); Index++) {
+			FVector Local;
+			const FIntVector TileCoordinates = GetTile(Settings, Positions[Index], Local);
+			if (!bLooked || TileCoordinates != LastTile) {
+				Tile = FindOrQueueTile(Volume, TileCoordinates);
+				LastTile = TileCoordinates;
+				bLooked = true;
+			}
+
+			if (Tile && Tile->Ready) {
+				Values[Index] = Interpolate(*Tile, Local);
+				Hits++;
+			} else {
+				Missing.Add(Index);
+				MissingPositions.Add(Positions[Index]);
+				Misses++;
+			}
+		}
+	}
+
+	if (Missing.Num() > 0) {
+		TArray<float> MissingValues;
+		USimplexNoise::SimplexNoiseBatch(MissingPositions, MissingValues, Settings.Scale, Settings.bTurbulence, Settings.Levels, Settings.OutputMin, Settings.OutputMax, Settings.LevelScale, Settings.FilterWidth);
+		for (int32 Index = 0; Index < Missing.Num(); Index++) {
+			Values[Missing[Index]] = MissingValues[Index];
+		}
+	}
+}
+
+bool FNoiseVolumeCache::Prefetch(int32 Volume, const FBox &Bounds)
+{
+	FScopeLock ScopeLock(&Lock);
+	check(Volumes.IsValidIndex(Volume));
+
+	FVector Local;
+	const FIntVector Min = GetTile(Volumes[Volume], Bounds.Min, Local);
+	const FIntVector Max = GetTile(Volumes[Volume], Bounds.Max, Local);
+
+	// The last tiles would evict the first ones before they are read
+	const int64 Count = (int64)(Max.X - Min.X + 1) * (Max.Y - Min.Y + 1) * (Max.Z - Min.Z + 1);
+	if (Count > MaxBytes / TileBytes) {
+		UE_LOG(LogTemp, Warning, TEXT("Noise volume prefetch of %lld tiles over the %lld tile budget, skipped"), Count, MaxBytes / TileBytes);
+		return false;
+	}
+
+	for (int32 Z = Min.Z; Z <= Max.Z; Z++) {
+		for (int32 Y = Min.Y; Y <= Max.Y; Y++) {
+			for (int32 X = Min.X; X <= Max.X; X++) {
+				FindOrQueueTile(Volume, FIntVector(X, Y, Z));
+			}
+		}
+	}
+	return true;
+}
+
+void FNoiseVolumeCache::Flush()
+{
+	TArray<FTilePtr> Pending;
+	{
+		FScopeLock ScopeLock(&Lock);
+		for (const TPair<FTileKey, FTilePtr> &Tile : Tiles) {
+			if (!Tile.Value->Ready) {
+				Pending.Add(Tile.Value);
+			}
+		}
+	}
+
+	for (const FTilePtr &Tile : Pending) {
+		Tile->Generation.Wait();
+	}
+
+	FScopeLock ScopeLock(&Lock);
+	EvictToBudget(MaxBytes);
+}
+
+void FNoiseVolumeCache::Empty()
+{
+	FScopeLock ScopeLock(&Lock);
+	Tiles.Empty();
+	MostRecent = nullptr;
+	LeastRecent = nullptr;
+	Bytes = 0;
+}
+
+void FNoiseVolumeCache::SetMaxBytes(int64 InMaxBytes)
+{
+	FScopeLock ScopeLock(&Lock);
+	MaxBytes = InMaxBytes;
+	EvictToBudget(MaxBytes);
+}
+
+FNoiseVolumeCache::FStats FNoiseVolumeCache::GetStats() const
+{
+	FScopeLock ScopeLock(&Lock);
+
+	FStats Stats;
+	Stats.Hits = Hits;
+	Stats.Misses = Misses;
+	Stats.Tiles = Tiles.Num();
+	Stats.Bytes = Bytes;
+	for (const TPair<FTileKey, FTilePtr> &Tile : Tiles) {
+		Stats.PendingTiles += Tile.Value->Ready ? 0 : 1;
+	}
+	return Stats;
+}
@@ -0,0 +1,131 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/ThreadSafeBool.h"
+#include "Async/Future.h"
+
+// USimplexNoise parameters baked into one noise volume, plus the spacing of its samples
+struct FNoiseVolumeSettings {
+	// World units between two cached samples, lookups are trilinear in between. At least MinVoxelSize.
+	float VoxelSize = 50.f;
+
+	float Scale = 1.f;
+	bool bTurbulence = true;
+	int32 Levels = 6;
+	float OutputMin = -1.f;
+	float OutputMax = 1.f;
+	float LevelScale = 2.f;
+	float FilterWidth = 0.f;
+
+	bool operator==(const FNoiseVolumeSettings &Other) const;
+};
+
+/**
+ * SimplexNoise baked into fixed size 3D tiles, generated on the thread pool and evicted least recently used first.
+ * Tiles store TileSamples^3 values so any lookup interpolates within a single tile.
+ * Every method is thread safe.
+ */
+class VENINE_API FNoiseVolumeCache
+{
+public:
+
+	// Cells per tile and axis
+	static const int32 TileSize = 16;
+	// Samples per tile and axis, tiles share their faces
+	static const int32 TileSamples = TileSize + 1;
+	static const int64 TileBytes = TileSamples * TileSamples * TileSamples * sizeof(float);
+	// Distinct settings kept at once, the least recently looked up volume and its tiles make room for new ones
+	static const int32 MaxVolumes = 64;
+	static constexpr float MinVoxelSize = 1.f;
+
+	// Pending tiles own their memory, the cache can go away while they are generated
+	explicit FNoiseVolumeCache(int64 InMaxBytes = 64 * 1024 * 1024);
+
+	// Shared by USimplexNoise::SimplexNoiseCached
+	static FNoiseVolumeCache &Get();
+
+	// Same settings, same volume. Indices are recycled past MaxVolumes, look them up again rather than keeping them.
+	int32 FindOrAddVolume(const FNoiseVolumeSettings &Settings);
+
+	// False while the tile is generated, its generation is queued if needed
+	bool TrySample(int32 Volume, const FVector &Position, float &Value);
+	// TrySample, or SimplexNoise directly while the tile is missing
+	float Sample(int32 Volume, const FVector &Position);
+	// FindOrAddVolume and Sample under a single lock
+	float Sample(const FNoiseVolumeSettings &Settings, const FVector &Position);
+	// Sample for every position under a single lock, misses are evaluated together afterwards
+	void SampleBatch(int32 Volume, const TArray<FVector> &Positions, TArray<float> &Values);
+
+	// Queues every tile overlapping Bounds. False, queuing nothing, when they wouldn't fit in MaxBytes together.
+	bool Prefetch(int32 Volume, const FBox &Bounds);
+	// Waits for every queued tile
+	void Flush();
+	void Empty();
+
+	void SetMaxBytes(int64 InMaxBytes);
+
+	struct FStats {
+		int64 Hits = 0;
+		int64 Misses = 0;
+		int32 Tiles = 0;
+		int32 PendingTiles = 0;
+		int64 Bytes = 0;
+	};
+	FStats GetStats() const;
+
+private:
+
+	struct FTileKey {
+		int32 Volume;
+		FIntVector Tile;
+
+		bool operator==(const FTileKey &Other) const { return Volume == Other.Volume && Tile == Other.Tile; }
+		friend uint32 GetTypeHash(const FTileKey &Key) { return HashCombine(GetTypeHash(Key.Volume), GetTypeHash(Key.Tile)); }
+	};
+
+	struct FTile {
+		FTileKey Key;
+		TArray<float> Samples;
+		FThreadSafeBool Ready;
+		TFuture<void> Generation;
+
+		// Least recently used list, guarded by the cache lock
+		FTile *Prev = nullptr;
+		FTile *Next = nullptr;
+	};
+
+	typedef TSharedPtr<FTile, ESPMode::ThreadSafe> FTilePtr;
+
+	// Lock must be held
+	int32 LookupVolume(const FNoiseVolumeSettings &Settings);
+	bool SampleTile(int32 Volume, const FVector &Position, float &Value);
+	// Queued when missing, null when pending tiles already fill MaxBytes. Lock must be held.
+	FTile *FindOrQueueTile(int32 Volume, const FIntVector &Tile);
+	void Touch(FTile *Tile);
+	void Unlink(FTile *Tile);
+	// Generated tiles only, least recently used first, until Bytes is within Budget
+	void EvictToBudget(int64 Budget);
+	void RemoveVolumeTiles(int32 Volume);
+
+	FIntVector GetTile(const FNoiseVolumeSettings &Settings, const FVector &Position, FVector &Local) const;
+	static float Interpolate(const FTile &Tile, const FVector &Local);
+
+	mutable FCriticalSection Lock;
+	TArray<FNoiseVolumeSettings> Volumes;
+	// FindOrAddVolume call count at each volume's last lookup
+	TArray<uint64> VolumeLastUse;
+	uint64 VolumeLookups = 0;
+	// Consecutive lookups mostly share their settings
+	int32 LastVolume = INDEX_NONE;
+	TMap<FTileKey, FTilePtr> Tiles;
+	FTile *MostRecent = nullptr;
+	FTile *LeastRecent = nullptr;
+
+	int64 MaxBytes;
+	// Generated and pending tiles
+	int64 Bytes = 0;
+	int64 Hits = 0;
+	int64 Misses = 0;
+};
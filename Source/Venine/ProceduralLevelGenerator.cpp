@@ -0,0 +1,231 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "ProceduralLevelGenerator.h"
+#include "Venine.h"
+#include "SimplexNoise.h"
+#include "Async/Async.h"
+#include "Components/HierarchicalInstancedStaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
+
+#define LOG(format, ...) UE_LOG(LogTemp, Log, TEXT(format), __VA_ARGS__)
+#define LOGW(format, ...) UE_LOG(LogTemp, Warning, TEXT(format), __VA_ARGS__)
+#define LOGE(format, ...) UE_LOG(LogTemp, Error, TEXT(format), __VA_ARGS__)
+
+DECLARE_CYCLE_STAT(TEXT("Level Chunk"), STAT_LevelChunk, STATGROUP_ProceduralLevel);
+DECLARE_CYCLE_STAT(TEXT("Level Instancing"), STAT_LevelInstancing, STATGROUP_ProceduralLevel);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Instances Added"), STAT_LevelInstancesAdded, STATGROUP_ProceduralLevel);
+
+AProceduralLevelGenerator::FBuildState::~FBuildState()
+{
+	FLevelChunkResult *Result;
+	while (Finished.Dequeue(Result)) {
+		delete Result;
+	}
+}
+
+AProceduralLevelGenerator::AProceduralLevelGenerator()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
+
+	RootComponent = CreateDefaultSubobject<USceneComponent>(TEXT("Root"));
+
+	FloorInstances = CreateDefaultSubobject<UHierarchicalInstancedStaticMeshComponent>(TEXT("FloorInstances"));
+	FloorInstances->SetupAttachment(RootComponent);
+	WallInstances = CreateDefaultSubobject<UHierarchicalInstancedStaticMeshComponent>(TEXT("WallInstances"));
+	WallInstances->SetupAttachment(RootComponent);
+
+	// Every AddInstance would rebuild the cluster tree, Tick builds it once per chunk instead
+	FloorInstances->bAutoRebuildTreeOnInstanceChanges = false;
+	WallInstances->bAutoRebuildTreeOnInstanceChanges = false;
+}
+
+void AProceduralLevelGenerator::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (bBuildOnBeginPlay) {
+		BuildLevel();
+	}
+}
+
+void AProceduralLevelGenerator::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	ClearLevel();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void AProceduralLevelGenerator::BuildLevel()
+{
+	ClearLevel();
+
+	FloorInstances->SetStaticMesh(FloorMesh);
+	WallInstances->SetStaticMesh(WallMesh);
+
+	FLevelGenerationSettings Settings;
+	Settings.MapSizeX = FMath::Max(MapSizeX, 1);
+	Settings.MapSizeY = FMath::Max(MapSizeY, 1);
+	Settings.ChunkSize = FMath::Max(ChunkSize, 1);
+	Settings.TileSize = TileSize;
+	Settings.NoiseScale = NoiseScale;
+	Settings.NoiseLevels = NoiseLevels;
+	Settings.bNoiseTurbulence = bNoiseTurbulence;
+	Settings.NoiseOffset = NoiseOffset;
+	Settings.FloorThreshold = FloorThreshold;
+
+	const int32 ChunksX = FMath::DivideAndRoundUp(Settings.MapSizeX, Settings.ChunkSize);
+	const int32 ChunksY = FMath::DivideAndRoundUp(Settings.MapSizeY, Settings.ChunkSize);
+	ChunksTotal = ChunksX * ChunksY;
+	ChunksInstanced = 0;
+	BuildStartTime = FPlatformTime::Seconds();
+
+	BuildState = MakeShareable(new FBuildState());
+
+	// Task graph workers steal chunks from each other, results come back in completion order
+	TSharedPtr<FBuildState, ESPMode::ThreadSafe> State = BuildState;
+	for (int32 Y = 0; Y < ChunksY; Y++) {
+		for (int32 X = 0; X < ChunksX; X++) {
+			const FIntPoint Chunk(X, Y);
+			Async<void>(EAsyncExecution::TaskGraph, [State, Settings, Chunk]() {
+				if (State->Cancelled) {
+					return;
+				}
+				State->Finished.Enqueue(GenerateChunk(Settings, Chunk));
+			});
+		}
+	}
+
+	SetActorTickEnabled(true);
+}
+
+void AProceduralLevelGenerator::ClearLevel()
+{
+	if (BuildState.IsValid()) {
+		BuildState->Cancelled = true;
+		BuildState.Reset();
+	}
+	Current.Reset();
+
+	FloorInstances->ClearInstances();
+	WallInstances->ClearInstances();
+
+	ChunksTotal = 0;
+	ChunksInstanced = 0;
+	SetActorTickEnabled(false);
+}
+
+FLevelChunkResult *AProceduralLevelGenerator::GenerateChunk(const FLevelGenerationSettings &Settings, FIntPoint Chunk)
+{
+	SCOPE_CYCLE_COUNTER(STAT_LevelChunk);
+
+	const int32 FirstX = Chunk.X * Settings.ChunkSize;
+	const int32 FirstY = Chunk.Y * Settings.ChunkSize;
+	const int32 SizeX = FMath::Min(Settings.ChunkSize, Settings.MapSizeX - FirstX);
+	const int32 SizeY = FMath::Min(Settings.ChunkSize, Settings.MapSizeY - FirstY);
+
+	// One tile of border so walls see the floors of neighbouring chunks
+	const int32 SamplesX = SizeX + 2;
+	const int32 SamplesY = SizeY + 2;
+	const int32 Count = SamplesX * SamplesY;
+
+	TArray<float> X, Y, Z, Noise;
+	X.SetNumUninitialized(Count);
+	Y.SetNumUninitialized(Count);
+	Z.SetNumUninitialized(Count);
+	Noise.SetNumUninitialized(Count);
+	for (int32 SampleY = 0, Index = 0; SampleY < SamplesY; SampleY++) {
+		for (int32 SampleX = 0; SampleX < SamplesX; SampleX++, Index++) {
+			X[Index] = FirstX + SampleX - 1 + Settings.NoiseOffset.X;
+			Y[Index] = FirstY + SampleY - 1 + Settings.NoiseOffset.Y;
+			Z[Index] = Settings.NoiseOffset.Z;
+		}
+	}
+
+	USimplexNoise::SimplexNoiseSoA(X.GetData(), Y.GetData(), Z.GetData(), Noise.GetData(), Count, Settings.NoiseScale, Settings.bNoiseTurbulence, Settings.NoiseLevels, 0.f, 1.f);
+
+	// Chunk local tile, -1 and Size are the border
+	auto IsFloor = [&](int32 TileX, int32 TileY) {
+		const int32 MapX = FirstX + TileX;
+		const int32 MapY = FirstY + TileY;
+		if (MapX < 0 || MapY < 0 || MapX >= Settings.MapSizeX || MapY >= Settings.MapSizeY) {
+			return false;
+		}
+		return Noise[(TileY + 1) * SamplesX + TileX + 1] > Settings.FloorThreshold;
+	};
+
+	static const FIntPoint Sides[4] = { FIntPoint(1, 0), FIntPoint(0, 1), FIntPoint(-1, 0), FIntPoint(0, -1) };
+
+	FLevelChunkResult *Result = new FLevelChunkResult();
+	for (int32 TileY = 0; TileY < SizeY; TileY++) {
+		for (int32 TileX = 0; TileX < SizeX; TileX++) {
+			if (!IsFloor(TileX, TileY)) {
+				continue;
+			}
+
+			const FVector Center((FirstX + TileX) * Settings.TileSize, (FirstY + TileY) * Settings.TileSize, 0);
+			Result->Floors.Add(FTransform(Center));
+
+			for (int32 Side = 0; Side < 4; Side++) {
+				if (!IsFloor(TileX + Sides[Side].X, TileY + Sides[Side].Y)) {
+					const FVector Edge = Center + FVector(Sides[Side].X, Sides[Side].Y, 0) * (Settings.TileSize / 2);
+					Result->Walls.Add(FTransform(FRotator(0, Side * 90.f, 0), Edge));
+				}
+			}
+		}
+	}
+
+	return Result;
+}
+
+void AProceduralLevelGenerator::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	SCOPE_CYCLE_COUNTER(STAT_LevelInstancing);
+
+	const double Deadline = FPlatformTime::Seconds() + InstanceBudgetMs / 1000.;
+	int32 Budget = InstancesPerFrame;
+
+	while (Budget > 0) {
+		if (!Current.IsValid()) {
+			FLevelChunkResult *Next;
+			if (!BuildState.IsValid() || !BuildState->Finished.Dequeue(Next)) {
+				break;
+			}
+			Current.Reset(Next);
+		}
+
+		const int32 Floors = Current->Floors.Num();
+		const int32 Total = Floors + Current->Walls.Num();
+		while (Budget > 0 && Current->Instanced < Total) {
+			const int32 Index = Current->Instanced++;
+			if (Index < Floors) {
+				if (FloorMesh) FloorInstances->AddInstance(Current->Floors[Index]);
+			} else {
+				if (WallMesh) WallInstances->AddInstance(Current->Walls[Index - Floors]);
+			}
+			INC_DWORD_STAT(STAT_LevelInstancesAdded);
+
+			// Clock read every few instances only
+			if (--Budget % 64 == 0 && FPlatformTime::Seconds() > Deadline) {
+				Budget = 0;
+			}
+		}
+
+		if (Current->Instanced == Total) {
+			// Instances of a chunk spread over several frames render unbuilt until then
+			if (FloorMesh && Floors > 0) FloorInstances->BuildTreeIfOutdated(true, false);
+			if (WallMesh && Total > Floors) WallInstances->BuildTreeIfOutdated(true, false);
+			Current.Reset();
+			ChunksInstanced++;
+		}
+	}
+
+	if (ChunksInstanced == ChunksTotal) {
+		LOG("%s built %d chunks, %d floors, %d walls in %.2fs", *GetName(), ChunksTotal, FloorInstances->GetInstanceCount(), WallInstances->GetInstanceCount(), FPlatformTime::Seconds() - BuildStartTime);
+		BuildState.Reset();
+		SetActorTickEnabled(false);
+		OnLevelBuilt.Broadcast();
+	}
+}
@@ -0,0 +1,138 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "Containers/Queue.h"
+#include "HAL/ThreadSafeBool.h"
+#include "ProceduralLevelGenerator.generated.h"
+
+class UHierarchicalInstancedStaticMeshComponent;
+class UStaticMesh;
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE(FOnLevelBuilt);
+
+// Everything a chunk task reads, copied so tasks never touch the actor
+struct FLevelGenerationSettings {
+	int32 MapSizeX;
+	int32 MapSizeY;
+	int32 ChunkSize;
+	float TileSize;
+	float NoiseScale;
+	int32 NoiseLevels;
+	bool bNoiseTurbulence;
+	FVector NoiseOffset;
+	float FloorThreshold;
+};
+
+// Instances of one chunk, relative to the generator
+struct FLevelChunkResult {
+	TArray<FTransform> Floors;
+	TArray<FTransform> Walls;
+	// Instances already added, floors first
+	int32 Instanced = 0;
+};
+
+/**
+ * C++ version of Trash/LevelGeneratorBP: a MapSizeX * MapSizeY grid of tiles, floors where the noise is above FloorThreshold and walls around them.
+ * Chunks are generated as task graph tasks, each one batch evaluating its noise, and handed back through a queue.
+ * The game thread instances finished chunks within InstancesPerFrame and InstanceBudgetMs.
+ */
+UCLASS()
+class VENINE_API AProceduralLevelGenerator : public AActor
+{
+	GENERATED_BODY()
+
+public:
+
+	AProceduralLevelGenerator();
+
+	virtual void Tick(float DeltaTime) override;
+
+	// Clears the current level and starts generating a new one
+	UFUNCTION(BlueprintCallable, Category = "Level Generation")
+	void BuildLevel();
+	// Removes every instance, chunks still generating are dropped
+	UFUNCTION(BlueprintCallable, Category = "Level Generation")
+	void ClearLevel();
+
+	UFUNCTION(BlueprintPure, Category = "Level Generation")
+	bool IsBuilding() const { return ChunksInstanced < ChunksTotal; }
+	// Fraction of chunks instanced
+	UFUNCTION(BlueprintPure, Category = "Level Generation")
+	float GetBuildProgress() const { return ChunksTotal > 0 ? (float)ChunksInstanced / ChunksTotal : 1.f; }
+
+	UPROPERTY(BlueprintAssignable, Category = "Level Generation")
+	FOnLevelBuilt OnLevelBuilt;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Level Generation")
+	bool bBuildOnBeginPlay = true;
+	// Tiles
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Level Generation", meta = (ClampMin = "1"))
+	int32 MapSizeX = 128;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Level Generation", meta = (ClampMin = "1"))
+	int32 MapSizeY = 128;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Level Generation")
+	float TileSize = 400.f;
+	// Tiles per chunk side, one task per chunk
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Level Generation", meta = (ClampMin = "1"))
+	int32 ChunkSize = 32;
+
+	// Noise frequency per tile
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Level Generation|Noise")
+	float NoiseScale = .05f;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Level Generation|Noise")
+	int32 NoiseLevels = 4;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Level Generation|Noise")
+	bool bNoiseTurbulence = false;
+	// In tiles, moves the level through the noise
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Level Generation|Noise")
+	FVector NoiseOffset = FVector::ZeroVector;
+	// Noise is in 0..1, tiles above are floors
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Level Generation|Noise")
+	float FloorThreshold = .5f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Level Generation|Meshes")
+	UStaticMesh *FloorMesh;
+	// Placed on tile edges, facing +X
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Level Generation|Meshes")
+	UStaticMesh *WallMesh;
+
+	// Instances added per frame at most
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Level Generation|Budget", meta = (ClampMin = "1"))
+	int32 InstancesPerFrame = 2000;
+	// Game thread time spent instancing per frame at most
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Level Generation|Budget")
+	float InstanceBudgetMs = 2.f;
+
+protected:
+
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+private:
+
+	// Shared with the chunk tasks of one build, outlives the actor if they do
+	struct FBuildState {
+		TQueue<FLevelChunkResult *, EQueueMode::Mpsc> Finished;
+		FThreadSafeBool Cancelled;
+
+		~FBuildState();
+	};
+
+	static FLevelChunkResult *GenerateChunk(const FLevelGenerationSettings &Settings, FIntPoint Chunk);
+
+	UPROPERTY()
+	UHierarchicalInstancedStaticMeshComponent *FloorInstances;
+	UPROPERTY()
+	UHierarchicalInstancedStaticMeshComponent *WallInstances;
+
+	TSharedPtr<FBuildState, ESPMode::ThreadSafe> BuildState;
+	// Chunk being instanced across frames
+	TUniquePtr<FLevelChunkResult> Current;
+
+	int32 ChunksTotal = 0;
+	int32 ChunksInstanced = 0;
+	double BuildStartTime = 0;
+};
@@ -2,10 +2,89 @@
 
 #include "SimplexNoise.h"
 #include "Venine.h"
+#include "Async/ParallelFor.h"
+#include "NoiseVolumeCache.h"
 
 
-uint32 USimplexNoise::NoiseTexture[USimplexNoise::NoiseTextureSize][USimplexNoise::NoiseTextureSize];
-bool USimplexNoise::NoiseTextureGenerated = false;
+/************ GRADIENTS ************/
+
+// Texel gradients of the former 128x128 RGB noise texture, built once on first use by GetGradientTable.
+// Texels are 1 byte gradient indices, gradients are float4 rows so a corner reads a single cache line.
+struct FSimplexGradientTable
+{
+	static const int32 Size = 128;
+	static const int32 Count = 12;
+
+	uint8 Texel[Size * Size];
+	alignas(16) float Gradient[Count][4];
+
+	FSimplexGradientTable()
+	{
+		// Values represent float3 values in the -1..1 range.
+		// The vectors are the edge mid point of a cube from -1 .. 1
+		const uint32 RGB[Count] =
+		{
+			0x88ffff, 0xff88ff, 0xffff88,
+			0x88ff00, 0xff8800, 0xff0088,
+			0x8800ff, 0x0088ff, 0x00ff88,
+			0x880000, 0x008800, 0x000088,
+		};
+		for (int32 Index = 0; Index < Count; Index++) {
+			// Texture2DSampleLevel decode, FVector(R, G, B) / 255. * 2 - 1
+			Gradient[Index][0] = (float)((RGB[Index] >> 16) & 0xff) * (1.f / 255.f) * 2.f - 1.f;
+			Gradient[Index][1] = (float)((RGB[Index] >> 8) & 0xff) * (1.f / 255.f) * 2.f - 1.f;
+			Gradient[Index][2] = (float)(RGB[Index] & 0xff) * (1.f / 255.f) * 2.f - 1.f;
+			Gradient[Index][3] = 0.f;
+		}
+
+		// FRandomStream(12345).GetFraction() sequence of the texture fill, stored [x][y]
+		uint32 Seed = 12345;
+		for (int32 y = 0; y < Size; ++y) {
+			for (int32 x = 0; x < Size; ++x) {
+				Seed = Seed * 196314165u + 907633515u;
+				const float Fraction = (float)(Seed & 0x007fffff) * (1.f / 8388608.f);
+				Texel[x * Size + y] = (uint8)(Fraction * 11.9999999f);
+			}
+		}
+	}
+};
+
+// Not constexpr, the 16384 texel loop is past what MSVC evaluates at compile time
+static const FSimplexGradientTable &GetGradientTable()
+{
+	static const FSimplexGradientTable Table;
+	return Table;
+}
+
+// Texel of lattice point (X, Y, Z) with the texture's Z shear, negative coordinates wrap like the texture sampler did
+static FORCEINLINE const float *GetGradient(float X, float Y, float Z)
+{
+	const FSimplexGradientTable &GradientTable = GetGradientTable();
+	const int32 TexelX = FMath::FloorToInt((X + Z * 17.f + 0.5f) * (1.f / 128.f)) & (FSimplexGradientTable::Size - 1);
+	const int32 TexelY = FMath::FloorToInt((Y + Z * 89.f + 0.5f) * (1.f / 128.f)) & (FSimplexGradientTable::Size - 1);
+	return GradientTable.Gradient[GradientTable.Texel[TexelX * FSimplexGradientTable::Size + TexelY]];
+}
+
+// The 2D and 4D lattices read one texel per lattice point, the 3D one keeps the texture addressing its output depends on
+static FORCEINLINE const float *GetGradient(int32 X, int32 Y)
+{
+	const FSimplexGradientTable &GradientTable = GetGradientTable();
+	const int32 Mask = FSimplexGradientTable::Size - 1;
+	return GradientTable.Gradient[GradientTable.Texel[(X & Mask) * FSimplexGradientTable::Size + (Y & Mask)]];
+}
+
+// XYZ from one sheared texel, W from the first component of a second one
+static FORCEINLINE void GetGradient(int32 X, int32 Y, int32 Z, int32 W, float Gradient[4])
+{
+	const float *GradientXYZ = GetGradient(X + Z * 17 + W * 59, Y + Z * 89 + W * 31);
+	const float *GradientW = GetGradient(Y + Z * 43 + W * 71, X + Z * 13 + W * 97);
+	Gradient[0] = GradientXYZ[0];
+	Gradient[1] = GradientXYZ[1];
+	Gradient[2] = GradientXYZ[2];
+	Gradient[3] = GradientW[0];
+}
+
+/***********************************/
 
 inline FVector SkewSimplex(FVector In)
 {
@@ -95,34 +174,10 @@ static FVector4 ComputeSimplexWeights3D(FVector OrthogonalPos, FVector &PosA, FV
 	return ret;
 }
 
-FVector USimplexNoise::Texture2DSampleLevel(FVector2D In)
-{
-
-	int x = fmod(In.X, NoiseTextureSize);
-	int y = fmod(In.Y, NoiseTextureSize);
-
-	uint32 lookup = NoiseTexture[x][y];
-
-	int R = (lookup & 0xff0000)/0X10000;
-	int G = (lookup & 0x00ff00)/0x100;
-	int B = (lookup & 0x0000ff);
-	FVector result = FVector(R, G, B)/255.;
-
-	
-	//UE_LOG(LogTemp, Log, TEXT("%d:%d:%d"), R, G, B);
-
-	return result;
-}
-
 FVector USimplexNoise::GetPerlinNoiseGradientTextureAt(FVector v)
 {
-	
-	const FVector2D ZShear = FVector2D(17, 89);
-
-	FVector2D OffsetA = v.Z * ZShear;
-	FVector2D TexA = (FVector2D(v.X,v.Y) + OffsetA + 0.5f) / 128.0f;
-
-	return Texture2DSampleLevel( TexA ) * 2 - 1;
+	const float *Gradient = GetGradient(v.X, v.Y, v.Z);
+	return FVector(Gradient[0], Gradient[1], Gradient[2]);
 }
 
 float USimplexNoise::SimplexNoise3D_TEX(FVector EvalPos)
@@ -184,71 +239,667 @@ float USimplexNoise::SimplexNoise3D_TEX(FVector EvalPos)
 	return res;
 }
 
+/************ FRACTAL ************/
+
+// Fractal sum shared by every dimension. FixedLevels > 0 unrolls the level loop, 0 reads Levels at runtime.
+// Turbulence and filtering are resolved at compile time, a filter width of 0 scales every level by exactly 1.
+template<int32 FixedLevels, bool bTurbulence, bool bFilter, typename PositionType, float (*Noise)(PositionType)>
+static float FractalKernel(PositionType Position, float Scale, int32 Levels, float OutputMin, float OutputMax, float LevelScale, float FilterWidth)
+{
+	Position = Position * Scale;
+	FilterWidth *= Scale;
+
+	float Out = 0.0f;
+	float OutScale = 1.0f;
+	float InvLevelScale = 1.0f / LevelScale;
+
+	const int32 LevelCount = FixedLevels > 0 ? FixedLevels : Levels;
+	for (int32 i = 0; i < LevelCount; ++i)
+	{
+		// fade out noise level that are too high frequent (not done through dynamic branching as it usually requires gradient instructions)
+		if (bFilter)
+		{
+			OutScale *= saturate(1.0 - FilterWidth);
+			FilterWidth *= LevelScale;
+		}
+
+		const float Level = Noise(Position);
+		Out += (bTurbulence ? FMath::Abs(Level) : Level) * OutScale;
+
+		Position = Position * LevelScale;
+		OutScale *= InvLevelScale;
+	}
+
+	if (!bTurbulence)
+	{
+		// bring -1..1 to 0..1 range
+		Out = Out * 0.5f + 0.5f;
+	}
+
+	// Out is in 0..1 range
+	return FMath::Lerp(OutputMin, OutputMax, Out);
+}
+
+#define FRACTAL_KERNELS(Levels) { \
+	{ &FractalKernel<Levels, false, false, PositionType, Noise>, &FractalKernel<Levels, false, true, PositionType, Noise> }, \
+	{ &FractalKernel<Levels, true, false, PositionType, Noise>, &FractalKernel<Levels, true, true, PositionType, Noise> } }
+
+// Kernel per level count, turbulence and filtering, built from constants so there is nothing to initialize
+template<typename PositionType, float (*Noise)(PositionType)>
+struct TFractalKernels
+{
+	typedef float (*FKernel)(PositionType, float, int32, float, float, float, float);
+
+	static FKernel Get(bool bTurbulence, int32 Levels, float FilterWidth)
+	{
+		static const FKernel Kernels[USimplexNoise::MaxKernelLevels + 1][2][2] =
+		{
+			FRACTAL_KERNELS(0), FRACTAL_KERNELS(1), FRACTAL_KERNELS(2), FRACTAL_KERNELS(3), FRACTAL_KERNELS(4),
+			FRACTAL_KERNELS(5), FRACTAL_KERNELS(6), FRACTAL_KERNELS(7), FRACTAL_KERNELS(8),
+		};
+		const int32 FixedLevels = Levels > 0 && Levels <= USimplexNoise::MaxKernelLevels ? Levels : 0;
+		return Kernels[FixedLevels][bTurbulence][FilterWidth != 0.f];
+	}
+};
+
+#undef FRACTAL_KERNELS
+
+USimplexNoise::FNoiseKernel USimplexNoise::GetNoiseKernel(bool bTurbulence, int32 Levels, float FilterWidth)
+{
+	return TFractalKernels<FVector, &SimplexNoise3D_TEX>::Get(bTurbulence, Levels, FilterWidth);
+}
+
 float USimplexNoise::SimplexNoise(FVector Position, float Scale, bool bTurbulence, int32 Levels, float OutputMin, float OutputMax, float LevelScale, float FilterWidth) {
 
+	return TFractalKernels<FVector, &SimplexNoise3D_TEX>::Get(bTurbulence, Levels, FilterWidth)(Position, Scale, Levels, OutputMin, OutputMax, LevelScale, FilterWidth);
+}
+
+float USimplexNoise::SimplexNoise2D(FVector2D Position, float Scale, bool bTurbulence, int32 Levels, float OutputMin, float OutputMax, float LevelScale, float FilterWidth)
+{
+	return TFractalKernels<FVector2D, &SimplexNoise2D_TEX>::Get(bTurbulence, Levels, FilterWidth)(Position, Scale, Levels, OutputMin, OutputMax, LevelScale, FilterWidth);
+}
+
+float USimplexNoise::SimplexNoise4D(FVector Position, float Time, float Scale, bool bTurbulence, int32 Levels, float OutputMin, float OutputMax, float LevelScale, float FilterWidth)
+{
+	return TFractalKernels<FVector4, &SimplexNoise4D_TEX>::Get(bTurbulence, Levels, FilterWidth)(FVector4(Position, Time), Scale, Levels, OutputMin, OutputMax, LevelScale, FilterWidth);
+}
+
+/*********************************/
+
+/************ 2D / 4D ************/
+
+float USimplexNoise::SimplexNoise2D_TEX(FVector2D EvalPos)
+{
+	// (sqrt(3) - 1) / 2 and (3 - sqrt(3)) / 6
+	const float Skew = 0.366025403f;
+	const float UnSkew = 0.211324865f;
+
+	const float SkewOffset = (EvalPos.X + EvalPos.Y) * Skew;
+	const int32 CellX = FMath::FloorToInt(EvalPos.X + SkewOffset);
+	const int32 CellY = FMath::FloorToInt(EvalPos.Y + SkewOffset);
+	const float UnSkewOffset = (CellX + CellY) * UnSkew;
+
+	FVector2D Delta[3];
+	Delta[0] = FVector2D(EvalPos.X - (CellX - UnSkewOffset), EvalPos.Y - (CellY - UnSkewOffset));
+
+	// Lower or upper triangle of the cell
+	const int32 StepX = Delta[0].X > Delta[0].Y ? 1 : 0;
+	const int32 StepY = 1 - StepX;
+	Delta[1] = FVector2D(Delta[0].X - StepX + UnSkew, Delta[0].Y - StepY + UnSkew);
+	Delta[2] = FVector2D(Delta[0].X - 1.f + 2.f * UnSkew, Delta[0].Y - 1.f + 2.f * UnSkew);
+
+	const int32 CornerX[3] = { CellX, CellX + StepX, CellX + 1 };
+	const int32 CornerY[3] = { CellY, CellY + StepY, CellY + 1 };
+
+	float Value = 0;
+	for (int32 Corner = 0; Corner < 3; Corner++) {
+		float DistanceWeight = .5f - FVector2D::DotProduct(Delta[Corner], Delta[Corner]);
+		if (DistanceWeight > 0) {
+			const float *Gradient = GetGradient(CornerX[Corner], CornerY[Corner]);
+			DistanceWeight *= DistanceWeight;
+			DistanceWeight *= DistanceWeight;
+			Value += (Gradient[0] * Delta[Corner].X + Gradient[1] * Delta[Corner].Y) * DistanceWeight;
+		}
+	}
+
+	return 70.f * Value;
+}
+
+float USimplexNoise::SimplexNoise4D_TEX(FVector4 EvalPos)
+{
+	// (sqrt(5) - 1) / 4 and (5 - sqrt(5)) / 20
+	const float Skew = 0.309016994f;
+	const float UnSkew = 0.138196601f;
+
+	const float Position[4] = { EvalPos.X, EvalPos.Y, EvalPos.Z, EvalPos.W };
+	const float SkewOffset = (Position[0] + Position[1] + Position[2] + Position[3]) * Skew;
+
+	int32 Cell[4];
+	for (int32 Axis = 0; Axis < 4; Axis++) {
+		Cell[Axis] = FMath::FloorToInt(Position[Axis] + SkewOffset);
+	}
+	const float UnSkewOffset = (Cell[0] + Cell[1] + Cell[2] + Cell[3]) * UnSkew;
+
+	float Origin[4];
+	for (int32 Axis = 0; Axis < 4; Axis++) {
+		Origin[Axis] = Position[Axis] - (Cell[Axis] - UnSkewOffset);
+	}
+
+	// Axes ranked by offset, the simplex steps along the largest first
+	int32 Rank[4] = { 0, 0, 0, 0 };
+	for (int32 A = 0; A < 4; A++) {
+		for (int32 B = A + 1; B < 4; B++) {
+			if (Origin[A] > Origin[B]) Rank[A]++;
+			else Rank[B]++;
+		}
+	}
+
+	float Value = 0;
+	for (int32 Corner = 0; Corner < 5; Corner++) {
+		int32 Lattice[4];
+		float Delta[4];
+		for (int32 Axis = 0; Axis < 4; Axis++) {
+			const int32 Step = Rank[Axis] >= 4 - Corner ? 1 : 0;
+			Lattice[Axis] = Cell[Axis] + Step;
+			Delta[Axis] = Origin[Axis] - Step + Corner * UnSkew;
+		}
+
+		float DistanceWeight = .6f - (Delta[0] * Delta[0] + Delta[1] * Delta[1] + Delta[2] * Delta[2] + Delta[3] * Delta[3]);
+		if (DistanceWeight > 0) {
+			float Gradient[4];
+			GetGradient(Lattice[0], Lattice[1], Lattice[2], Lattice[3], Gradient);
+			DistanceWeight *= DistanceWeight;
+			DistanceWeight *= DistanceWeight;
+			Value += (Gradient[0] * Delta[0] + Gradient[1] * Delta[1] + Gradient[2] * Delta[2] + Gradient[3] * Delta[3]) * DistanceWeight;
+		}
+	}
+
+	return 27.f * Value;
+}
+
+/*********************************/
+
+/************ GRADIENT ************/
+
+float USimplexNoise::SimplexNoise3D_TEX(FVector EvalPos, FVector &Gradient)
+{
+	FVector Corners[4];
+	ComputeSimplexWeights3D(SkewSimplex(EvalPos), Corners[0], Corners[1], Corners[2], Corners[3]);
+
+	float Value = 0;
+	Gradient = FVector::ZeroVector;
+
+	for (const FVector &Corner : Corners) {
+		const FVector CornerGradient = GetPerlinNoiseGradientTextureAt(Corner);
+		const FVector Delta = EvalPos - UnSkewSimplex(Corner);
+
+		// Same falloff as the value only version, its slope is -2 * Delta inside the radius and 0 outside
+		const float DistanceWeight = saturate(.6f - length2(Delta));
+		const float DistanceWeight2 = DistanceWeight * DistanceWeight;
+		const float DistanceWeight4 = DistanceWeight2 * DistanceWeight2;
+		const float Dot = FVector::DotProduct(CornerGradient, Delta);
+
+		Value += Dot * DistanceWeight4;
+		Gradient += CornerGradient * DistanceWeight4 - Delta * (8.f * DistanceWeight2 * DistanceWeight * Dot);
+	}
+
+	Gradient *= 32.f;
+	return 32.f * Value;
+}
+
+float USimplexNoise::SimplexNoiseGradient(FVector Position, FVector &Gradient, float Scale, bool bTurbulence, int32 Levels, float OutputMin, float OutputMax, float LevelScale, float FilterWidth)
+{
 	Position *= Scale;
 	FilterWidth *= Scale;
 
 	float Out = 0.0f;
+	FVector OutGradient = FVector::ZeroVector;
 	float OutScale = 1.0f;
 	float InvLevelScale = 1.0f / LevelScale;
+	// Chain rule of Position *= Scale, LevelScale
+	float Frequency = Scale;
 
 	for (int32 i = 0; i < Levels; ++i)
 	{
-		// fade out noise level that are too high frequent (not done through dynamic branching as it usually requires gradient instructions)
 		OutScale *= saturate(1.0 - FilterWidth);
 
-		if (bTurbulence)
+		FVector LevelGradient;
+		float Level = SimplexNoise3D_TEX(Position, LevelGradient);
+
+		// Abs flips the slope of negative lobes
+		if (bTurbulence && Level < 0)
 		{
-			Out += FMath::Abs(SimplexNoise3D_TEX(Position)) * OutScale;
+			Level = -Level;
+			LevelGradient = -LevelGradient;
 		}
-		else
-		{
-			Out += SimplexNoise3D_TEX(Position) * OutScale;
-		}		
+
+		Out += Level * OutScale;
+		OutGradient += LevelGradient * (OutScale * Frequency);
 
 		Position *= LevelScale;
 		OutScale *= InvLevelScale;
 		FilterWidth *= LevelScale;
+		Frequency *= LevelScale;
 	}
 
 	if (!bTurbulence)
 	{
-		// bring -1..1 to 0..1 range
 		Out = Out * 0.5f + 0.5f;
+		OutGradient *= 0.5f;
 	}
 
-	// Out is in 0..1 range
+	Gradient = OutGradient * (OutputMax - OutputMin);
 	return FMath::Lerp(OutputMin, OutputMax, Out);
-	
 }
 
-USimplexNoise::USimplexNoise() {
+/**********************************/
+
+/************ BATCH ************/
+
+// Rounds toward -inf like FloorToInt, integers stay put
+static FORCEINLINE VectorRegister VectorFloorLanes(const VectorRegister &V)
+{
+	const VectorRegister Truncated = VectorTruncate(V);
+	return VectorSubtract(Truncated, VectorBitwiseAnd(VectorCompareGT(Truncated, V), VectorOne()));
+}
+
+// X*K + Y*K + Z*K, same order as FVector::DotProduct
+static FORCEINLINE VectorRegister VectorSumScaled(const VectorRegister &X, const VectorRegister &Y, const VectorRegister &Z, const VectorRegister &K)
+{
+	return VectorAdd(VectorAdd(VectorMultiply(X, K), VectorMultiply(Y, K)), VectorMultiply(Z, K));
+}
 
-	if (NoiseTextureGenerated) {
-		return;
+// Corners as in ComputeSimplexWeights3D, ties select every tied axis
+static FORCEINLINE void VectorSimplexCorners3D(const VectorRegister &X, const VectorRegister &Y, const VectorRegister &Z, VectorRegister CornerX[4], VectorRegister CornerY[4], VectorRegister CornerZ[4])
+{
+	const VectorRegister One = VectorOne();
+	const VectorRegister Skew = VectorSetFloat1(1.0 / 3.0f);
+
+	const VectorRegister SkewOffset = VectorSumScaled(X, Y, Z, Skew);
+	const VectorRegister OrthogonalX = VectorAdd(X, SkewOffset);
+	const VectorRegister OrthogonalY = VectorAdd(Y, SkewOffset);
+	const VectorRegister OrthogonalZ = VectorAdd(Z, SkewOffset);
+
+	CornerX[0] = VectorFloorLanes(OrthogonalX);
+	CornerY[0] = VectorFloorLanes(OrthogonalY);
+	CornerZ[0] = VectorFloorLanes(OrthogonalZ);
+
+	const VectorRegister FracX = VectorSubtract(OrthogonalX, CornerX[0]);
+	const VectorRegister FracY = VectorSubtract(OrthogonalY, CornerY[0]);
+	const VectorRegister FracZ = VectorSubtract(OrthogonalZ, CornerZ[0]);
+	const VectorRegister Largest = VectorMax(VectorMax(FracX, FracY), FracZ);
+	const VectorRegister Smallest = VectorMin(VectorMin(FracX, FracY), FracZ);
+
+	CornerX[1] = VectorAdd(CornerX[0], One);
+	CornerY[1] = VectorAdd(CornerY[0], One);
+	CornerZ[1] = VectorAdd(CornerZ[0], One);
+	CornerX[2] = VectorAdd(CornerX[0], VectorBitwiseAnd(VectorCompareEQ(Largest, FracX), One));
+	CornerY[2] = VectorAdd(CornerY[0], VectorBitwiseAnd(VectorCompareEQ(Largest, FracY), One));
+	CornerZ[2] = VectorAdd(CornerZ[0], VectorBitwiseAnd(VectorCompareEQ(Largest, FracZ), One));
+	CornerX[3] = VectorAdd(CornerX[0], VectorBitwiseAnd(VectorCompareNE(Smallest, FracX), One));
+	CornerY[3] = VectorAdd(CornerY[0], VectorBitwiseAnd(VectorCompareNE(Smallest, FracY), One));
+	CornerZ[3] = VectorAdd(CornerZ[0], VectorBitwiseAnd(VectorCompareNE(Smallest, FracZ), One));
+}
+
+// Falloff weighted dot product of one corner, same operation order as the scalar version
+static FORCEINLINE VectorRegister VectorSimplexCorner3D(const VectorRegister &X, const VectorRegister &Y, const VectorRegister &Z,
+	const VectorRegister &CornerX, const VectorRegister &CornerY, const VectorRegister &CornerZ,
+	const VectorRegister &GradX, const VectorRegister &GradY, const VectorRegister &GradZ)
+{
+	const VectorRegister UnSkewOffset = VectorSumScaled(CornerX, CornerY, CornerZ, VectorSetFloat1(1.0 / 6.0f));
+	const VectorRegister DeltaX = VectorSubtract(X, VectorSubtract(CornerX, UnSkewOffset));
+	const VectorRegister DeltaY = VectorSubtract(Y, VectorSubtract(CornerY, UnSkewOffset));
+	const VectorRegister DeltaZ = VectorSubtract(Z, VectorSubtract(CornerZ, UnSkewOffset));
+
+	const VectorRegister Length2 = VectorAdd(VectorAdd(VectorMultiply(DeltaX, DeltaX), VectorMultiply(DeltaY, DeltaY)), VectorMultiply(DeltaZ, DeltaZ));
+	VectorRegister DistanceWeight = VectorMin(VectorMax(VectorSubtract(VectorSetFloat1(.6f), Length2), VectorZero()), VectorOne());
+	DistanceWeight = VectorMultiply(DistanceWeight, DistanceWeight);
+	DistanceWeight = VectorMultiply(DistanceWeight, DistanceWeight);
+
+	const VectorRegister Dot = VectorAdd(VectorAdd(VectorMultiply(GradX, DeltaX), VectorMultiply(GradY, DeltaY)), VectorMultiply(GradZ, DeltaZ));
+	return VectorMultiply(Dot, DistanceWeight);
+}
+
+VectorRegister USimplexNoise::SimplexNoise3D_TEX(const VectorRegister &X, const VectorRegister &Y, const VectorRegister &Z)
+{
+	const VectorRegister ShearX = VectorSetFloat1(17.f);
+	const VectorRegister ShearY = VectorSetFloat1(89.f);
+	const VectorRegister Half = VectorSetFloat1(0.5f);
+	const VectorRegister InvSize = VectorSetFloat1(1.f / 128.f);
+	const FSimplexGradientTable &GradientTable = GetGradientTable();
+
+	VectorRegister CornerX[4], CornerY[4], CornerZ[4];
+	VectorSimplexCorners3D(X, Y, Z, CornerX, CornerY, CornerZ);
+
+	VectorRegister Sum = VectorZero();
+
+	for (int32 Corner = 0; Corner < 4; Corner++) {
+
+		// Texel coordinates as in GetGradient, then read lane by lane since VectorRegister has no gather
+		float TexelX[4], TexelY[4];
+		float GradX[4], GradY[4], GradZ[4];
+		VectorStore(VectorMultiply(VectorAdd(VectorAdd(CornerX[Corner], VectorMultiply(CornerZ[Corner], ShearX)), Half), InvSize), TexelX);
+		VectorStore(VectorMultiply(VectorAdd(VectorAdd(CornerY[Corner], VectorMultiply(CornerZ[Corner], ShearY)), Half), InvSize), TexelY);
+		for (int32 Lane = 0; Lane < 4; Lane++) {
+			const int32 Texel = (FMath::FloorToInt(TexelX[Lane]) & (FSimplexGradientTable::Size - 1)) * FSimplexGradientTable::Size + (FMath::FloorToInt(TexelY[Lane]) & (FSimplexGradientTable::Size - 1));
+			const float *Gradient = GradientTable.Gradient[GradientTable.Texel[Texel]];
+			GradX[Lane] = Gradient[0];
+			GradY[Lane] = Gradient[1];
+			GradZ[Lane] = Gradient[2];
+		}
+
+		Sum = VectorAdd(Sum, VectorSimplexCorner3D(X, Y, Z, CornerX[Corner], CornerY[Corner], CornerZ[Corner], VectorLoad(GradX), VectorLoad(GradY), VectorLoad(GradZ)));
 	}
 
-	FRandomStream RandomStream(12345);
+	return VectorMultiply(VectorSetFloat1(32.f), Sum);
+}
 
-	// Values represent float3 values in the -1..1 range.
-	// The vectors are the edge mid point of a cube from -1 .. 1
-	static uint32 gradtable[] =
-	{
-		0x88ffff, 0xff88ff, 0xffff88,
-		0x88ff00, 0xff8800, 0xff0088,
-		0x8800ff, 0x0088ff, 0x00ff88,
-		0x880000, 0x008800, 0x000088,
+// Four positions per register and the seed of their field
+typedef VectorRegister (*FLanesNoise)(const VectorRegister &X, const VectorRegister &Y, const VectorRegister &Z, const VectorRegisterInt &Seed);
+
+// The table holds a single field, Seed is unused
+template<VectorRegister (*Noise)(const VectorRegister &, const VectorRegister &, const VectorRegister &)>
+static FORCEINLINE VectorRegister Unseeded(const VectorRegister &X, const VectorRegister &Y, const VectorRegister &Z, const VectorRegisterInt &Seed)
+{
+	return Noise(X, Y, Z);
+}
+
+// FractalKernel four positions per register, over a whole structure of arrays range
+template<int32 FixedLevels, bool bTurbulence, bool bFilter, FLanesNoise Noise>
+static void FractalLanesKernel(const float *X, const float *Y, const float *Z, float *Values, int32 Count, uint32 Seed, float Scale, int32 Levels, float OutputMin, float OutputMax, float LevelScale, float FilterWidth)
+{
+	const VectorRegister ScaleMul = VectorSetFloat1(Scale);
+	const VectorRegister LevelMul = VectorSetFloat1(LevelScale);
+	const VectorRegister Half = VectorSetFloat1(0.5f);
+	const VectorRegister RangeMin = VectorSetFloat1(OutputMin);
+	const VectorRegister Range = VectorSetFloat1(OutputMax - OutputMin);
+	const VectorRegisterInt SeedLanes = MakeVectorRegisterInt((int32)Seed, (int32)Seed, (int32)Seed, (int32)Seed);
+	const int32 LevelCount = FixedLevels > 0 ? FixedLevels : Levels;
+
+	auto Evaluate = [&](VectorRegister PosX, VectorRegister PosY, VectorRegister PosZ) {
+		PosX = VectorMultiply(PosX, ScaleMul);
+		PosY = VectorMultiply(PosY, ScaleMul);
+		PosZ = VectorMultiply(PosZ, ScaleMul);
+		float LevelFilterWidth = FilterWidth * Scale;
+
+		VectorRegister Out = VectorZero();
+		float OutScale = 1.0f;
+		float InvLevelScale = 1.0f / LevelScale;
+
+		for (int32 i = 0; i < LevelCount; ++i)
+		{
+			if (bFilter)
+			{
+				OutScale *= saturate(1.0 - LevelFilterWidth);
+				LevelFilterWidth *= LevelScale;
+			}
+
+			const VectorRegister Level = Noise(PosX, PosY, PosZ, SeedLanes);
+			Out = VectorAdd(Out, VectorMultiply(bTurbulence ? VectorAbs(Level) : Level, VectorSetFloat1(OutScale)));
+
+			PosX = VectorMultiply(PosX, LevelMul);
+			PosY = VectorMultiply(PosY, LevelMul);
+			PosZ = VectorMultiply(PosZ, LevelMul);
+			OutScale *= InvLevelScale;
+		}
+
+		if (!bTurbulence)
+		{
+			Out = VectorAdd(VectorMultiply(Out, Half), Half);
+		}
+
+		return VectorAdd(RangeMin, VectorMultiply(Out, Range));
 	};
-	for (int32 y = 0; y < NoiseTextureSize; ++y)
+
+	int32 Index = 0;
+	for (; Index + 4 <= Count; Index += 4) {
+		VectorStore(Evaluate(VectorLoad(X + Index), VectorLoad(Y + Index), VectorLoad(Z + Index)), Values + Index);
+	}
+
+	// Tail padded with zeros, only the valid lanes are written back
+	if (Index < Count) {
+		float TailX[4] = { 0 }, TailY[4] = { 0 }, TailZ[4] = { 0 }, TailValues[4];
+		const int32 Remaining = Count - Index;
+		for (int32 Lane = 0; Lane < Remaining; Lane++) {
+			TailX[Lane] = X[Index + Lane];
+			TailY[Lane] = Y[Index + Lane];
+			TailZ[Lane] = Z[Index + Lane];
+		}
+		VectorStore(Evaluate(VectorLoad(TailX), VectorLoad(TailY), VectorLoad(TailZ)), TailValues);
+		FMemory::Memcpy(Values + Index, TailValues, Remaining * sizeof(float));
+	}
+}
+
+#define FRACTAL_LANES_KERNELS(Levels) { \
+	{ &FractalLanesKernel<Levels, false, false, Noise>, &FractalLanesKernel<Levels, false, true, Noise> }, \
+	{ &FractalLanesKernel<Levels, true, false, Noise>, &FractalLanesKernel<Levels, true, true, Noise> } }
+
+template<FLanesNoise Noise>
+struct TFractalLanesKernels
+{
+	typedef void (*FKernel)(const float *, const float *, const float *, float *, int32, uint32, float, int32, float, float, float, float);
+
+	static FKernel Get(bool bTurbulence, int32 Levels, float FilterWidth)
 	{
-		for (int32 x = 0; x < NoiseTextureSize; ++x)
+		static const FKernel Kernels[USimplexNoise::MaxKernelLevels + 1][2][2] =
 		{
-			USimplexNoise::NoiseTexture[x][y] = gradtable[(uint32)(RandomStream.GetFraction() * 11.9999999f)];
+			FRACTAL_LANES_KERNELS(0), FRACTAL_LANES_KERNELS(1), FRACTAL_LANES_KERNELS(2), FRACTAL_LANES_KERNELS(3), FRACTAL_LANES_KERNELS(4),
+			FRACTAL_LANES_KERNELS(5), FRACTAL_LANES_KERNELS(6), FRACTAL_LANES_KERNELS(7), FRACTAL_LANES_KERNELS(8),
+		};
+		const int32 FixedLevels = Levels > 0 && Levels <= USimplexNoise::MaxKernelLevels ? Levels : 0;
+		return Kernels[FixedLevels][bTurbulence][FilterWidth != 0.f];
+	}
+};
+
+#undef FRACTAL_LANES_KERNELS
+
+void USimplexNoise::SimplexNoiseSoA(const float *X, const float *Y, const float *Z, float *Values, int32 Count, float Scale, bool bTurbulence, int32 Levels, float OutputMin, float OutputMax, float LevelScale, float FilterWidth)
+{
+	// Kernel selected once for the whole range
+	TFractalLanesKernels<&Unseeded<&SimplexNoise3D_TEX>>::Get(bTurbulence, Levels, FilterWidth)(X, Y, Z, Values, Count, 0, Scale, Levels, OutputMin, OutputMax, LevelScale, FilterWidth);
+}
+
+void USimplexNoise::SimplexNoiseSoAParallel(const float *X, const float *Y, const float *Z, float *Values, int32 Count, float Scale, bool bTurbulence, int32 Levels, float OutputMin, float OutputMax, float LevelScale, float FilterWidth, int32 ChunkSize)
+{
+	// Whole registers per chunk
+	ChunkSize = Align(FMath::Max(ChunkSize, 4), 4);
+	const int32 Chunks = FMath::DivideAndRoundUp(Count, ChunkSize);
+
+	ParallelFor(Chunks, [&](int32 Chunk) {
+		const int32 Start = Chunk * ChunkSize;
+		SimplexNoiseSoA(X + Start, Y + Start, Z + Start, Values + Start, FMath::Min(ChunkSize, Count - Start), Scale, bTurbulence, Levels, OutputMin, OutputMax, LevelScale, FilterWidth);
+	}, Chunks < 2);
+}
+
+void USimplexNoise::SimplexNoiseBatchRange(const FVector *Positions, float *Values, int32 Count, float Scale, bool bTurbulence, int32 Levels, float OutputMin, float OutputMax, float LevelScale, float FilterWidth)
+{
+	// Transposed through the stack, small enough to stay in L1
+	const int32 BlockSize = 64;
+	float X[BlockSize], Y[BlockSize], Z[BlockSize];
+
+	for (int32 Start = 0; Start < Count; Start += BlockSize) {
+		const int32 Num = FMath::Min(BlockSize, Count - Start);
+		for (int32 Index = 0; Index < Num; Index++) {
+			X[Index] = Positions[Start + Index].X;
+			Y[Index] = Positions[Start + Index].Y;
+			Z[Index] = Positions[Start + Index].Z;
 		}
+		SimplexNoiseSoA(X, Y, Z, Values + Start, Num, Scale, bTurbulence, Levels, OutputMin, OutputMax, LevelScale, FilterWidth);
 	}
+}
+
+void USimplexNoise::SimplexNoiseBatch(const TArray<FVector> &Positions, TArray<float> &Values, float Scale, bool bTurbulence, int32 Levels, float OutputMin, float OutputMax, float LevelScale, float FilterWidth)
+{
+	Values.SetNumUninitialized(Positions.Num());
+	SimplexNoiseBatchRange(Positions.GetData(), Values.GetData(), Positions.Num(), Scale, bTurbulence, Levels, OutputMin, OutputMax, LevelScale, FilterWidth);
+}
 
-	NoiseTextureGenerated = true;
+void USimplexNoise::SimplexNoiseBatchParallel(const TArray<FVector> &Positions, TArray<float> &Values, float Scale, bool bTurbulence, int32 Levels, float OutputMin, float OutputMax, float LevelScale, float FilterWidth, int32 ChunkSize)
+{
+	Values.SetNumUninitialized(Positions.Num());
+
+	ChunkSize = FMath::Max(ChunkSize, 1);
+	const int32 Chunks = FMath::DivideAndRoundUp(Positions.Num(), ChunkSize);
 
-	/*UE_LOG(LogTemp, Warning, TEXT("TEXTURE CONSTRUCTED"));*/
+	ParallelFor(Chunks, [&](int32 Chunk) {
+		const int32 Start = Chunk * ChunkSize;
+		SimplexNoiseBatchRange(Positions.GetData() + Start, Values.GetData() + Start, FMath::Min(ChunkSize, Positions.Num() - Start), Scale, bTurbulence, Levels, OutputMin, OutputMax, LevelScale, FilterWidth);
+	}, Chunks < 2);
 }
+
+/*******************************/
+
+/************ HASH ************/
+
+// Gradients of the seeded mode, hashed from the lattice point instead of read from the table.
+// Integer arithmetic only, so seeds share no state and the lane version does no memory access at all.
+static FORCEINLINE uint32 HashLattice(int32 X, int32 Y, int32 Z, uint32 Seed)
+{
+	uint32 Hash = Seed ^ ((uint32)X * 0x8da6b343u) ^ ((uint32)Y * 0xd8163841u) ^ ((uint32)Z * 0xcb1ab31fu);
+	Hash ^= Hash >> 16;
+	Hash *= 0x7feb352du;
+	Hash ^= Hash >> 15;
+	Hash *= 0x846ca68bu;
+	Hash ^= Hash >> 16;
+	return Hash;
+}
+
+// 1 with the sign of bit Component of Hash, 0 on Axis. Built from bits since compilers turn selects on a random axis back into branches.
+static FORCEINLINE float GetHashedComponent(uint32 Hash, uint32 Axis, uint32 Component)
+{
+	union { uint32 Bits; float Value; } Result;
+	Result.Bits = (0x3f800000u | ((Hash >> Component) & 1) << 31) & (0u - (uint32)(Axis != Component));
+	return Result.Value;
+}
+
+// One of the 12 cube edge mid points like the table: zero on axis ((Hash >> 16) * 3) >> 16, the other signs from the low bits
+static FORCEINLINE FVector GetHashedGradient(uint32 Hash)
+{
+	const uint32 Axis = ((Hash >> 16) * 3) >> 16;
+	return FVector(GetHashedComponent(Hash, Axis, 0), GetHashedComponent(Hash, Axis, 1), GetHashedComponent(Hash, Axis, 2));
+}
+
+static FORCEINLINE VectorRegisterInt VectorIntSplat(uint32 Value)
+{
+	return MakeVectorRegisterInt((int32)Value, (int32)Value, (int32)Value, (int32)Value);
+}
+
+static FORCEINLINE VectorRegisterInt VectorHashLattice(const VectorRegister &X, const VectorRegister &Y, const VectorRegister &Z, const VectorRegisterInt &Seed)
+{
+	// Corners are whole numbers, truncation is exact
+	VectorRegisterInt Hash = VectorIntXor(
+		VectorIntXor(Seed, VectorIntMultiply(VectorFloatToInt(X), VectorIntSplat(0x8da6b343u))),
+		VectorIntXor(VectorIntMultiply(VectorFloatToInt(Y), VectorIntSplat(0xd8163841u)), VectorIntMultiply(VectorFloatToInt(Z), VectorIntSplat(0xcb1ab31fu))));
+	Hash = VectorIntXor(Hash, VectorShiftRightImmLogical(Hash, 16));
+	Hash = VectorIntMultiply(Hash, VectorIntSplat(0x7feb352du));
+	Hash = VectorIntXor(Hash, VectorShiftRightImmLogical(Hash, 15));
+	Hash = VectorIntMultiply(Hash, VectorIntSplat(0x846ca68bu));
+	Hash = VectorIntXor(Hash, VectorShiftRightImmLogical(Hash, 16));
+	return Hash;
+}
+
+static FORCEINLINE void VectorHashedGradient(const VectorRegisterInt &Hash, VectorRegister &GradX, VectorRegister &GradY, VectorRegister &GradZ)
+{
+	const VectorRegister Zero = VectorZero();
+	const VectorRegister One = VectorOne();
+	const VectorRegister Two = VectorSetFloat1(2.f);
+	const VectorRegisterInt Bit = VectorIntSplat(1);
+
+	const VectorRegister Axis = VectorIntToFloat(VectorShiftRightImmLogical(VectorIntMultiply(VectorShiftRightImmLogical(Hash, 16), VectorIntSplat(3)), 16));
+	GradX = VectorSelect(VectorCompareEQ(Axis, Zero), Zero, VectorSubtract(One, VectorMultiply(Two, VectorIntToFloat(VectorIntAnd(Hash, Bit)))));
+	GradY = VectorSelect(VectorCompareEQ(Axis, One), Zero, VectorSubtract(One, VectorMultiply(Two, VectorIntToFloat(VectorIntAnd(VectorShiftRightImmLogical(Hash, 1), Bit)))));
+	GradZ = VectorSelect(VectorCompareEQ(Axis, Two), Zero, VectorSubtract(One, VectorMultiply(Two, VectorIntToFloat(VectorIntAnd(VectorShiftRightImmLogical(Hash, 2), Bit)))));
+}
+
+// Position in the field of one seed, scaled by the fractal like a plain position
+struct FSeededPosition
+{
+	FVector Position;
+	uint32 Seed;
+
+	FSeededPosition operator*(float Scale) const { return { Position * Scale, Seed }; }
+};
+
+// SimplexNoise3D_TEX with hashed gradients. Every lattice point gets its own gradient, the texture's coarse addressing is not reproduced.
+static float SimplexNoise3D_HASH(FSeededPosition EvalPos)
+{
+	FVector Corners[4];
+	ComputeSimplexWeights3D(SkewSimplex(EvalPos.Position), Corners[0], Corners[1], Corners[2], Corners[3]);
+
+	float Value = 0;
+	for (const FVector &Corner : Corners) {
+		const FVector Gradient = GetHashedGradient(HashLattice((int32)Corner.X, (int32)Corner.Y, (int32)Corner.Z, EvalPos.Seed));
+		const FVector Delta = EvalPos.Position - UnSkewSimplex(Corner);
+
+		float DistanceWeight = saturate(.6f - length2(Delta));
+		DistanceWeight *= DistanceWeight;
+		DistanceWeight *= DistanceWeight;
+		Value += FVector::DotProduct(Gradient, Delta) * DistanceWeight;
+	}
+
+	return 32.f * Value;
+}
+
+// Lane version, bit identical to the scalar one
+static VectorRegister SimplexNoise3D_HASH(const VectorRegister &X, const VectorRegister &Y, const VectorRegister &Z, const VectorRegisterInt &Seed)
+{
+	VectorRegister CornerX[4], CornerY[4], CornerZ[4];
+	VectorSimplexCorners3D(X, Y, Z, CornerX, CornerY, CornerZ);
+
+	VectorRegister Sum = VectorZero();
+	for (int32 Corner = 0; Corner < 4; Corner++) {
+		VectorRegister GradX, GradY, GradZ;
+		VectorHashedGradient(VectorHashLattice(CornerX[Corner], CornerY[Corner], CornerZ[Corner], Seed), GradX, GradY, GradZ);
+		Sum = VectorAdd(Sum, VectorSimplexCorner3D(X, Y, Z, CornerX[Corner], CornerY[Corner], CornerZ[Corner], GradX, GradY, GradZ));
+	}
+
+	return VectorMultiply(VectorSetFloat1(32.f), Sum);
+}
+
+float USimplexNoise::SimplexNoiseSeeded(FVector Position, int32 Seed, float Scale, bool bTurbulence, int32 Levels, float OutputMin, float OutputMax, float LevelScale, float FilterWidth)
+{
+	const FSeededPosition SeededPosition = { Position, (uint32)Seed };
+	return TFractalKernels<FSeededPosition, &SimplexNoise3D_HASH>::Get(bTurbulence, Levels, FilterWidth)(SeededPosition, Scale, Levels, OutputMin, OutputMax, LevelScale, FilterWidth);
+}
+
+void USimplexNoise::SimplexNoiseSeededSoA(const float *X, const float *Y, const float *Z, float *Values, int32 Count, int32 Seed, float Scale, bool bTurbulence, int32 Levels, float OutputMin, float OutputMax, float LevelScale, float FilterWidth)
+{
+	TFractalLanesKernels<&SimplexNoise3D_HASH>::Get(bTurbulence, Levels, FilterWidth)(X, Y, Z, Values, Count, (uint32)Seed, Scale, Levels, OutputMin, OutputMax, LevelScale, FilterWidth);
+}
+
+void USimplexNoise::SimplexNoiseSeededSoAParallel(const float *X, const float *Y, const float *Z, float *Values, int32 Count, int32 Seed, float Scale, bool bTurbulence, int32 Levels, float OutputMin, float OutputMax, float LevelScale, float FilterWidth, int32 ChunkSize)
+{
+	ChunkSize = Align(FMath::Max(ChunkSize, 4), 4);
+	const int32 Chunks = FMath::DivideAndRoundUp(Count, ChunkSize);
+
+	ParallelFor(Chunks, [&](int32 Chunk) {
+		const int32 Start = Chunk * ChunkSize;
+		SimplexNoiseSeededSoA(X + Start, Y + Start, Z + Start, Values + Start, FMath::Min(ChunkSize, Count - Start), Seed, Scale, bTurbulence, Levels, OutputMin, OutputMax, LevelScale, FilterWidth);
+	}, Chunks < 2);
+}
+
+/******************************/
+
+/************ CACHE ************/
+
+float USimplexNoise::SimplexNoiseCached(FVector Position, float VoxelSize, float Scale, bool bTurbulence, int32 Levels, float OutputMin, float OutputMax, float LevelScale, float FilterWidth)
+{
+	// Blueprints can pass anything, tile keys need a sane voxel
+	if (!ensureMsgf(VoxelSize >= FNoiseVolumeCache::MinVoxelSize, TEXT("SimplexNoiseCached VoxelSize %f below %f, evaluating directly"), VoxelSize, FNoiseVolumeCache::MinVoxelSize)) {
+		return SimplexNoise(Position, Scale, bTurbulence, Levels, OutputMin, OutputMax, LevelScale, FilterWidth);
+	}
+
+	FNoiseVolumeSettings Settings;
+	Settings.VoxelSize = VoxelSize;
+	Settings.Scale = Scale;
+	Settings.bTurbulence = bTurbulence;
+	Settings.Levels = Levels;
+	Settings.OutputMin = OutputMin;
+	Settings.OutputMax = OutputMax;
+	Settings.LevelScale = LevelScale;
+	Settings.FilterWidth = FilterWidth;
+
+	return FNoiseVolumeCache::Get().Sample(Settings, Position);
+}
+
+/*******************************/
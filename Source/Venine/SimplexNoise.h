@@ -16,18 +16,60 @@ class VENINE_API USimplexNoise : public UBlueprintFunctionLibrary
 
 public:
 
-	USimplexNoise();
-
 	UFUNCTION(BlueprintCallable, Category = "Noise")
 	static float SimplexNoise(FVector Position, float Scale = 1., bool bTurbulence = true, int32 Levels = 6, float OutputMin = -1., float OutputMax = 1., float LevelScale = 2., float FilterWidth = 0.);
-	
-private:
 
-	static const uint32 NoiseTextureSize = 128;
-	static uint32 NoiseTexture[NoiseTextureSize][NoiseTextureSize];
-	static bool NoiseTextureGenerated;
+	// Heightfields, three corners per sample instead of four
+	UFUNCTION(BlueprintCallable, Category = "Noise")
+	static float SimplexNoise2D(FVector2D Position, float Scale = 1., bool bTurbulence = true, int32 Levels = 6, float OutputMin = -1., float OutputMax = 1., float LevelScale = 2., float FilterWidth = 0.);
+	// Time animated fields, Time is scaled like Position
+	UFUNCTION(BlueprintCallable, Category = "Noise")
+	static float SimplexNoise4D(FVector Position, float Time, float Scale = 1., bool bTurbulence = true, int32 Levels = 6, float OutputMin = -1., float OutputMax = 1., float LevelScale = 2., float FilterWidth = 0.);
+
+	// Level counts with an unrolled kernel, more levels fall back to a runtime loop
+	static const int32 MaxKernelLevels = 8;
+
+	// SimplexNoise with Levels, bTurbulence and filtering resolved once, for loops over many positions
+	typedef float (*FNoiseKernel)(FVector Position, float Scale, int32 Levels, float OutputMin, float OutputMax, float LevelScale, float FilterWidth);
+	static FNoiseKernel GetNoiseKernel(bool bTurbulence, int32 Levels, float FilterWidth);
+
+	// SimplexNoise and its analytic gradient with respect to Position, in the same pass
+	UFUNCTION(BlueprintCallable, Category = "Noise")
+	static float SimplexNoiseGradient(FVector Position, FVector &Gradient, float Scale = 1., bool bTurbulence = true, int32 Levels = 6, float OutputMin = -1., float OutputMax = 1., float LevelScale = 2., float FilterWidth = 0.);
+
+	// SimplexNoise baked into the shared noise volume cache, trilinear between samples VoxelSize apart.
+	// Evaluated directly while the tile around Position is generated in the background, and when VoxelSize is below 1.
+	UFUNCTION(BlueprintCallable, Category = "Noise")
+	static float SimplexNoiseCached(FVector Position, float VoxelSize = 50., float Scale = 1., bool bTurbulence = true, int32 Levels = 6, float OutputMin = -1., float OutputMax = 1., float LevelScale = 2., float FilterWidth = 0.);
+
+	// SimplexNoise of every position, four at a time
+	UFUNCTION(BlueprintCallable, Category = "Noise")
+	static void SimplexNoiseBatch(const TArray<FVector> &Positions, TArray<float> &Values, float Scale = 1., bool bTurbulence = true, int32 Levels = 6, float OutputMin = -1., float OutputMax = 1., float LevelScale = 2., float FilterWidth = 0.);
+	// SimplexNoiseBatch split in ChunkSize positions over the task graph
+	UFUNCTION(BlueprintCallable, Category = "Noise")
+	static void SimplexNoiseBatchParallel(const TArray<FVector> &Positions, TArray<float> &Values, float Scale = 1., bool bTurbulence = true, int32 Levels = 6, float OutputMin = -1., float OutputMax = 1., float LevelScale = 2., float FilterWidth = 0., int32 ChunkSize = 4096);
+
+	// Structure of arrays versions, Count floats in each of X, Y, Z and Values, no alignment required
+	static void SimplexNoiseSoA(const float *X, const float *Y, const float *Z, float *Values, int32 Count, float Scale = 1., bool bTurbulence = true, int32 Levels = 6, float OutputMin = -1., float OutputMax = 1., float LevelScale = 2., float FilterWidth = 0.);
+	static void SimplexNoiseSoAParallel(const float *X, const float *Y, const float *Z, float *Values, int32 Count, float Scale = 1., bool bTurbulence = true, int32 Levels = 6, float OutputMin = -1., float OutputMax = 1., float LevelScale = 2., float FilterWidth = 0., int32 ChunkSize = 4096);
+
+	// SimplexNoise with gradients hashed from the lattice and Seed instead of read from the gradient table.
+	// No table traffic and one independent field per Seed, but no Seed gives the SimplexNoise field.
+	UFUNCTION(BlueprintCallable, Category = "Noise")
+	static float SimplexNoiseSeeded(FVector Position, int32 Seed, float Scale = 1., bool bTurbulence = true, int32 Levels = 6, float OutputMin = -1., float OutputMax = 1., float LevelScale = 2., float FilterWidth = 0.);
+	// Structure of arrays versions, same values as SimplexNoiseSeeded
+	static void SimplexNoiseSeededSoA(const float *X, const float *Y, const float *Z, float *Values, int32 Count, int32 Seed, float Scale = 1., bool bTurbulence = true, int32 Levels = 6, float OutputMin = -1., float OutputMax = 1., float LevelScale = 2., float FilterWidth = 0.);
+	static void SimplexNoiseSeededSoAParallel(const float *X, const float *Y, const float *Z, float *Values, int32 Count, int32 Seed, float Scale = 1., bool bTurbulence = true, int32 Levels = 6, float OutputMin = -1., float OutputMax = 1., float LevelScale = 2., float FilterWidth = 0., int32 ChunkSize = 4096);
+
+private:
 
-	static FVector Texture2DSampleLevel(FVector2D In);
 	static FVector GetPerlinNoiseGradientTextureAt(FVector v);
+	static float SimplexNoise2D_TEX(FVector2D EvalPos);
 	static float SimplexNoise3D_TEX(FVector EvalPos);
+	static float SimplexNoise4D_TEX(FVector4 EvalPos);
+	static float SimplexNoise3D_TEX(FVector EvalPos, FVector &Gradient);
+
+	// Four positions per register
+	static VectorRegister SimplexNoise3D_TEX(const VectorRegister &X, const VectorRegister &Y, const VectorRegister &Z);
+	static void SimplexNoiseBatchRange(const FVector *Positions, float *Values, int32 Count, float Scale, bool bTurbulence, int32 Levels, float OutputMin, float OutputMax, float LevelScale, float FilterWidth);
 };
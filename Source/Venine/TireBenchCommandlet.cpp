@@ -0,0 +1,478 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "TireBenchCommandlet.h"
+#include "AdvancedWheelComponent.h"
+#include "Venine.h"
+#include "HAL/PlatformTime.h"
+#include "HAL/PlatformTLS.h"
+#include "HAL/ThreadSafeCounter.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "UObject/Package.h"
+#include "UObject/UObjectGlobals.h"
+#include "Engine/World.h"
+#include "TireReplay.h"
+
+#define LOG(format, ...) UE_LOG(LogTemp, Log, TEXT(format), __VA_ARGS__)
+#define LOGW(format, ...) UE_LOG(LogTemp, Warning, TEXT(format), __VA_ARGS__)
+#define LOGE(format, ...) UE_LOG(LogTemp, Error, TEXT(format), __VA_ARGS__)
+
+/************ ALLOCATION COUNTING ************/
+
+// Forwards to the engine allocator, counting the allocations of the thread that created it while installed.
+// Other threads keep allocating through it untouched, everything it hands out belongs to the engine allocator.
+class FTireBenchMalloc : public FMalloc
+{
+public:
+	FTireBenchMalloc(FMalloc *InInner) : Inner(InInner), CountedThread(FPlatformTLS::GetCurrentThreadId()) {}
+
+	virtual void* Malloc(SIZE_T Count, uint32 Alignment) override { CountAllocation(); return Inner->Malloc(Count, Alignment); }
+	virtual void* Realloc(void *Original, SIZE_T Count, uint32 Alignment) override { if (Count) CountAllocation(); return Inner->Realloc(Original, Count, Alignment); }
+	virtual void Free(void *Original) override { Inner->Free(Original); }
+	virtual SIZE_T QuantizeSize(SIZE_T Count, uint32 Alignment) override { return Inner->QuantizeSize(Count, Alignment); }
+	virtual bool GetAllocationSize(void *Original, SIZE_T &SizeOut) override { return Inner->GetAllocationSize(Original, SizeOut); }
+	virtual void Trim() override { Inner->Trim(); }
+	virtual void SetupTLSCachesOnCurrentThread() override { Inner->SetupTLSCachesOnCurrentThread(); }
+	virtual void ClearAndDisableTLSCachesOnCurrentThread() override { Inner->ClearAndDisableTLSCachesOnCurrentThread(); }
+	virtual bool IsInternallyThreadSafe() const override { return Inner->IsInternallyThreadSafe(); }
+	virtual bool ValidateHeap() override { return Inner->ValidateHeap(); }
+	virtual const TCHAR* GetDescriptiveName() override { return TEXT("TireBench"); }
+
+	FThreadSafeCounter Allocations;
+
+private:
+	void CountAllocation()
+	{
+		if (FPlatformTLS::GetCurrentThreadId() == CountedThread) {
+			Allocations.Increment();
+		}
+	}
+
+	FMalloc *Inner;
+	uint32 CountedThread;
+};
+
+/************ ANALYTIC GROUND ************/
+
+// Ground shapes extruded along Y, the wheel rolls along X
+struct FTireBenchPrimitive {
+	enum EType { Plane, Cylinder, InnerCylinder };
+	EType Type;
+
+	// Plane: unit normal out of the ground in XZ and N.P of its points. Cylinders: center in XZ and radius
+	FVector2D Normal = FVector2D(0, 1);
+	float Offset = 0;
+	FVector2D Center = FVector2D::ZeroVector;
+	float Radius = 0;
+
+	// Impact points outside these bounds are not part of the primitive
+	FVector2D Min = FVector2D(-BIG_NUMBER, -BIG_NUMBER);
+	FVector2D Max = FVector2D(BIG_NUMBER, BIG_NUMBER);
+
+	static FTireBenchPrimitive MakePlane(const FVector2D &InNormal, const FVector2D &Point)
+	{
+		FTireBenchPrimitive Primitive;
+		Primitive.Type = Plane;
+		Primitive.Normal = InNormal.GetSafeNormal();
+		Primitive.Offset = Primitive.Normal | Point;
+		return Primitive;
+	}
+
+	static FTireBenchPrimitive MakeCylinder(EType InType, const FVector2D &InCenter, float InRadius)
+	{
+		FTireBenchPrimitive Primitive;
+		Primitive.Type = InType;
+		Primitive.Center = InCenter;
+		Primitive.Radius = InRadius;
+		return Primitive;
+	}
+
+	FTireBenchPrimitive &Bound(const FVector2D &InMin, const FVector2D &InMax)
+	{
+		Min = InMin;
+		Max = InMax;
+		return *this;
+	}
+
+	bool Contains(const FVector2D &Impact) const
+	{
+		const float Tolerance = KINDA_SMALL_NUMBER;
+		return Impact.X >= Min.X - Tolerance && Impact.X <= Max.X + Tolerance && Impact.Y >= Min.Y - Tolerance && Impact.Y <= Max.Y + Tolerance;
+	}
+
+	// Earliest time in [0, 1] a sphere moving Start to End touches the primitive, with the impact point and the normal out of the ground
+	bool Sweep(const FVector2D &Start, const FVector2D &End, float SphereRadius, float &OutTime, FVector2D &OutImpact, FVector2D &OutNormal) const
+	{
+		const FVector2D Delta = End - Start;
+
+		if (Type == Plane) {
+			const float StartDistance = (Normal | Start) - Offset;
+			const float EndDistance = (Normal | End) - Offset;
+
+			if (StartDistance <= SphereRadius) {
+				OutTime = 0;
+			} else if (EndDistance < SphereRadius) {
+				OutTime = (StartDistance - SphereRadius) / (StartDistance - EndDistance);
+			} else {
+				return false;
+			}
+
+			OutNormal = Normal;
+			OutImpact = Start + Delta * OutTime - Normal * ((Normal | (Start + Delta * OutTime)) - Offset);
+			return Contains(OutImpact);
+		}
+
+		// Sphere center against the circle grown (outside) or shrunk (inside) by the sphere radius
+		const bool Inside = Type == InnerCylinder;
+		const float Reach = Inside ? Radius - SphereRadius : Radius + SphereRadius;
+		const FVector2D Relative = Start - Center;
+		const float C = Relative.SizeSquared() - Reach * Reach;
+
+		if (Inside ? C >= 0 : C <= 0) {
+			OutTime = 0;
+		} else {
+			const float A = Delta.SizeSquared();
+			const float B = 2 * (Relative | Delta);
+			const float Discriminant = B * B - 4 * A * C;
+			if (A < SMALL_NUMBER || Discriminant < 0) {
+				return false;
+			}
+
+			OutTime = (-B + (Inside ? 1 : -1) * FMath::Sqrt(Discriminant)) / (2 * A);
+			if (OutTime < 0 || OutTime > 1) {
+				return false;
+			}
+		}
+
+		const FVector2D Direction = (Start + Delta * OutTime - Center).GetSafeNormal();
+		OutNormal = Inside ? -Direction : Direction;
+		OutImpact = Center + Direction * Radius;
+		return Contains(OutImpact);
+	}
+};
+
+class FTireBenchGround : public ITireGroundQuery
+{
+public:
+	TArray<FTireBenchPrimitive> Primitives;
+
+	virtual bool SweepSphere(FHitResult &OutHit, const FVector &Start, const FVector &End, float Radius) const override
+	{
+		const FVector2D Start2D(Start.X, Start.Z);
+		const FVector2D End2D(End.X, End.Z);
+
+		float BestTime = MAX_flt;
+		FVector2D BestImpact, BestNormal;
+
+		for (const FTireBenchPrimitive &Primitive : Primitives) {
+			float Time;
+			FVector2D Impact, Normal;
+			if (Primitive.Sweep(Start2D, End2D, Radius, Time, Impact, Normal) && Time < BestTime) {
+				BestTime = Time;
+				BestImpact = Impact;
+				BestNormal = Normal;
+			}
+		}
+
+		if (BestTime == MAX_flt) {
+			return false;
+		}
+
+		const FVector Location = FMath::Lerp(Start, End, BestTime);
+
+		OutHit = FHitResult(BestTime);
+		OutHit.bBlockingHit = true;
+		OutHit.bStartPenetrating = BestTime == 0;
+		OutHit.TraceStart = Start;
+		OutHit.TraceEnd = End;
+		OutHit.Location = Location;
+		OutHit.ImpactPoint = FVector(BestImpact.X, Location.Y, BestImpact.Y);
+		OutHit.ImpactNormal = OutHit.Normal = FVector(BestNormal.X, 0, BestNormal.Y);
+		OutHit.Distance = (Location - Start).Size();
+		return true;
+	}
+
+	virtual bool OverlapSphere(const FVector &Center, float Radius) const override
+	{
+		FHitResult Hit;
+		return SweepSphere(Hit, Center, Center, Radius) && Hit.bStartPenetrating;
+	}
+
+	static bool Make(const FString &Case, float WheelRadius, FTireBenchGround &Ground, FVector &OutStart, float &OutSpeed)
+	{
+		Ground.Primitives.Reset();
+		OutStart = FVector(-150, 0, WheelRadius);
+
+		if (Case == TEXT("plane")) {
+			Ground.Primitives.Add(FTireBenchPrimitive::MakePlane(FVector2D(0, 1), FVector2D::ZeroVector));
+		}
+		else if (Case == TEXT("step")) {
+			const float Height = 8;
+			Ground.Primitives.Add(FTireBenchPrimitive::MakePlane(FVector2D(0, 1), FVector2D::ZeroVector).Bound(FVector2D(-BIG_NUMBER, -BIG_NUMBER), FVector2D(0, BIG_NUMBER)));
+			Ground.Primitives.Add(FTireBenchPrimitive::MakePlane(FVector2D(0, 1), FVector2D(0, Height)).Bound(FVector2D(0, -BIG_NUMBER), FVector2D(BIG_NUMBER, BIG_NUMBER)));
+			Ground.Primitives.Add(FTireBenchPrimitive::MakePlane(FVector2D(-1, 0), FVector2D::ZeroVector).Bound(FVector2D(-BIG_NUMBER, 0), FVector2D(BIG_NUMBER, Height)));
+			Ground.Primitives.Add(FTireBenchPrimitive::MakeCylinder(FTireBenchPrimitive::Cylinder, FVector2D(0, Height), 0));
+		}
+		else if (Case == TEXT("bump")) {
+			const float Radius = 40;
+			const float Height = 10;
+			Ground.Primitives.Add(FTireBenchPrimitive::MakePlane(FVector2D(0, 1), FVector2D::ZeroVector));
+			Ground.Primitives.Add(FTireBenchPrimitive::MakeCylinder(FTireBenchPrimitive::Cylinder, FVector2D(0, Height - Radius), Radius));
+		}
+		else if (Case == TEXT("loop")) {
+			const float Radius = 400;
+			Ground.Primitives.Add(FTireBenchPrimitive::MakeCylinder(FTireBenchPrimitive::InnerCylinder, FVector2D(0, Radius), Radius));
+			// Enough speed to stay on the ceiling, v^2 > 5 g r
+			OutStart = FVector(0, 0, WheelRadius);
+			OutSpeed = FMath::Max(OutSpeed, FMath::Sqrt(5 * 980 * Radius) * 1.1f);
+		}
+		else if (Case == TEXT("ramp")) {
+			const float Slope = FMath::DegreesToRadians(15);
+			Ground.Primitives.Add(FTireBenchPrimitive::MakePlane(FVector2D(0, 1), FVector2D::ZeroVector).Bound(FVector2D(-BIG_NUMBER, -BIG_NUMBER), FVector2D(0, BIG_NUMBER)));
+			Ground.Primitives.Add(FTireBenchPrimitive::MakePlane(FVector2D(-FMath::Sin(Slope), FMath::Cos(Slope)), FVector2D::ZeroVector).Bound(FVector2D(0, -BIG_NUMBER), FVector2D(BIG_NUMBER, BIG_NUMBER)));
+		}
+		else {
+			return false;
+		}
+
+		return true;
+	}
+};
+
+/************ BENCH ************/
+
+UTireBenchCommandlet::UTireBenchCommandlet()
+{
+	IsClient = false;
+	IsEditor = false;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UTireBenchCommandlet::Main(const FString &Params)
+{
+	FString Cases = TEXT("all");
+	int32 Substeps = 2000;
+	float DeltaTime = 0.002;
+	float StartSpeed = 500;
+	float Mass = 150;
+	int32 Density = 50;
+	FString CSVDirectory;
+
+	FParse::Value(*Params, TEXT("case="), Cases);
+	FParse::Value(*Params, TEXT("substeps="), Substeps);
+	FParse::Value(*Params, TEXT("dt="), DeltaTime);
+	FParse::Value(*Params, TEXT("speed="), StartSpeed);
+	FParse::Value(*Params, TEXT("mass="), Mass);
+	FParse::Value(*Params, TEXT("density="), Density);
+	FParse::Value(*Params, TEXT("csv="), CSVDirectory);
+
+	FString ReplayFile;
+	if (FParse::Value(*Params, TEXT("replay="), ReplayFile)) {
+		return RunReplay(Params, ReplayFile, Density, CSVDirectory);
+	}
+
+	TArray<FString> CaseNames;
+	if (Cases == TEXT("all")) {
+		CaseNames = { TEXT("plane"), TEXT("step"), TEXT("bump"), TEXT("loop"), TEXT("ramp") };
+	} else {
+		Cases.ParseIntoArray(CaseNames, TEXT(","));
+	}
+
+	const FVector Gravity(0, 0, -980);
+	int32 Failures = 0;
+
+	for (const FString &Case : CaseNames) {
+
+		UAdvancedWheelComponent *Wheel = NewObject<UAdvancedWheelComponent>(GetTransientPackage());
+		Wheel->WheelToroidalDensity = Density;
+		Wheel->VectorizedForceKernel = !FParse::Param(*Params, TEXT("scalar"));
+		Wheel->SpringIntegration = FParse::Param(*Params, TEXT("semiimplicit")) ? ETireSpringIntegration::SemiImplicit : ETireSpringIntegration::Explicit;
+		// Substeps run without PrepareSubstep, set the inputs it would latch
+		Wheel->SubstepEnginePower = 0;
+		Wheel->SubstepBreakPower = 0;
+		Wheel->DebugDraws = false;
+		Wheel->DebugLogs = false;
+		Wheel->InitializeSamples();
+
+		const float WheelRadius = Wheel->WheelTireInnerRadius + Wheel->WheelTireRadius;
+		const float Inertia = .5f * Mass * WheelRadius * WheelRadius;
+
+		FTireBenchGround Ground;
+		FVector Position;
+		float Speed = StartSpeed;
+		if (!FTireBenchGround::Make(Case, WheelRadius, Ground, Position, Speed)) {
+			LOGE("TireBench: unknown case %s", *Case);
+			Failures++;
+			continue;
+		}
+		Wheel->GroundQuery = &Ground;
+
+		// Planar rig, the wheel translates in XZ and spins around its Y axle
+		FVector Velocity(Speed, 0, 0);
+		float Spin = Speed / WheelRadius;
+		float Angle = 0;
+
+		FString CSV = TEXT("Time,X,Z,VelocityX,VelocityZ,Spin,ForceX,ForceZ,TorqueY,HitSamples\n");
+
+		FTireBenchMalloc CountingMalloc(GMalloc);
+		uint64 Cycles = 0;
+		int32 Allocations = 0;
+		const int32 TracesBefore = Wheel->PendingStats.TotalTraces;
+		bool Exploded = false;
+
+		for (int32 Substep = 0; Substep < Substeps; Substep++) {
+
+			Wheel->SetWheelTransform(FTransform(FQuat(FVector::RightVector, Angle), Position));
+			Wheel->BodyState.CenterOfMass = Position;
+			Wheel->BodyState.LinearVelocity = Velocity;
+			Wheel->BodyState.AngularVelocity = FVector(0, Spin, 0);
+			Wheel->BodyState.Mass = Mass;
+
+			// Measured region, the force model alone
+			FMalloc *EngineMalloc = GMalloc;
+			GMalloc = &CountingMalloc;
+			const uint64 StartCycles = FPlatformTime::Cycles64();
+
+			Wheel->ComputeSubstep(DeltaTime);
+			if (Wheel->PendingStats.HitTraces > 0) {
+				Wheel->ComputeNetWrench(Wheel->SubstepHitWeight);
+			} else {
+				Wheel->LastNetForce = FVector::ZeroVector;
+				Wheel->LastNetTorque = FVector::ZeroVector;
+			}
+
+			Cycles += FPlatformTime::Cycles64() - StartCycles;
+			GMalloc = EngineMalloc;
+
+			const FVector Force = Wheel->LastNetForce;
+			const FVector Torque = Wheel->LastNetTorque;
+
+			Velocity += (FVector(Force.X, 0, Force.Z) / Mass + Gravity) * DeltaTime;
+			Position += Velocity * DeltaTime;
+			Spin += Torque.Y / Inertia * DeltaTime;
+			Angle += Spin * DeltaTime;
+
+			if (Position.ContainsNaN() || FMath::IsNaN(Spin)) {
+				LOGE("TireBench %s: blew up at substep %d", *Case, Substep);
+				Exploded = true;
+				break;
+			}
+
+			if (!CSVDirectory.IsEmpty()) {
+				CSV += FString::Printf(TEXT("%f,%f,%f,%f,%f,%f,%f,%f,%f,%d\n"), Substep * DeltaTime, Position.X, Position.Z, Velocity.X, Velocity.Z, Spin, Force.X, Force.Z, Torque.Y, Wheel->PendingStats.HitTraces);
+			}
+		}
+		Allocations = CountingMalloc.Allocations.GetValue();
+
+		const int32 Sweeps = Wheel->PendingStats.TotalTraces - TracesBefore;
+		const double Nanoseconds = FPlatformTime::ToSeconds64(Cycles) * 1e9;
+
+		LOG("TireBench %-5s: %d substeps of %.4fs, %.1f ns/substep, %.1f sweeps/substep, %.2f allocs/substep, end X=%.1f Z=%.1f speed=%.1f",
+			*Case, Substeps, DeltaTime, Nanoseconds / Substeps, (float)Sweeps / Substeps, (float)Allocations / Substeps, Position.X, Position.Z, Velocity.Size());
+
+		if (!CSVDirectory.IsEmpty()) {
+			const FString File = FPaths::Combine(CSVDirectory, Case + TEXT(".csv"));
+			if (!FFileHelper::SaveStringToFile(CSV, *File)) {
+				LOGE("TireBench: couldn't write %s", *File);
+			}
+		}
+
+		Failures += Exploded;
+	}
+
+	return Failures;
+}
+
+int32 UTireBenchCommandlet::RunReplay(const FString &Params, const FString &ReplayFile, int32 Density, const FString &CSVDirectory)
+{
+	FTireReplay Replay;
+	if (!Replay.Load(ReplayFile) || Replay.Frames.Num() == 0) {
+		return 1;
+	}
+
+	// Level geometry when a map is given, the scene needs its components registered to answer queries
+	UWorld *World = nullptr;
+	FString MapName;
+	if (FParse::Value(*Params, TEXT("map="), MapName)) {
+		UPackage *Package = LoadPackage(nullptr, *MapName, LOAD_None);
+		World = Package ? UWorld::FindWorldInPackage(Package) : nullptr;
+		if (!World) {
+			LOGE("TireBench: couldn't load map %s", *MapName);
+			return 1;
+		}
+		World->AddToRoot();
+		World->InitWorld();
+		World->UpdateWorldComponents(true, false);
+	}
+
+	UAdvancedWheelComponent *Wheel = NewObject<UAdvancedWheelComponent>(World ? (UObject*)World : GetTransientPackage());
+	Wheel->WheelToroidalDensity = Density;
+	Wheel->VectorizedForceKernel = !FParse::Param(*Params, TEXT("scalar"));
+	Wheel->SpringIntegration = FParse::Param(*Params, TEXT("semiimplicit")) ? ETireSpringIntegration::SemiImplicit : ETireSpringIntegration::Explicit;
+	Wheel->DebugDraws = false;
+	Wheel->DebugLogs = false;
+	Wheel->InitializeSamples();
+
+	FTireBenchGround Ground;
+	if (!World) {
+		FString Case = TEXT("plane");
+		FParse::Value(*Params, TEXT("case="), Case);
+		FVector Start;
+		float Speed = 0;
+		if (!FTireBenchGround::Make(Case, Wheel->WheelTireInnerRadius + Wheel->WheelTireRadius, Ground, Start, Speed)) {
+			LOGE("TireBench: unknown case %s", *Case);
+			return 1;
+		}
+		Wheel->GroundQuery = &Ground;
+	}
+
+	FString CSV = TEXT("Substep,ForceX,ForceY,ForceZ,TorqueX,TorqueY,TorqueZ,HitSamples\n");
+
+	FTireBenchMalloc CountingMalloc(GMalloc);
+	uint64 Cycles = 0;
+
+	for (int32 Substep = 0; Substep < Replay.Frames.Num(); Substep++) {
+		const FTireReplayFrame &Frame = Replay.Frames[Substep];
+		Wheel->ApplyReplayFrame(Frame);
+
+		FMalloc *EngineMalloc = GMalloc;
+		GMalloc = &CountingMalloc;
+		const uint64 StartCycles = FPlatformTime::Cycles64();
+
+		Wheel->ComputeSubstep(Frame.DeltaTime);
+		if (Wheel->PendingStats.HitTraces > 0) {
+			Wheel->ComputeNetWrench(Wheel->SubstepHitWeight);
+		} else {
+			Wheel->LastNetForce = FVector::ZeroVector;
+			Wheel->LastNetTorque = FVector::ZeroVector;
+		}
+
+		Cycles += FPlatformTime::Cycles64() - StartCycles;
+		GMalloc = EngineMalloc;
+
+		if (!CSVDirectory.IsEmpty()) {
+			const FVector &Force = Wheel->LastNetForce;
+			const FVector &Torque = Wheel->LastNetTorque;
+			CSV += FString::Printf(TEXT("%d,%f,%f,%f,%f,%f,%f,%d\n"), Substep, Force.X, Force.Y, Force.Z, Torque.X, Torque.Y, Torque.Z, Wheel->PendingStats.HitTraces);
+		}
+	}
+
+	const int32 Substeps = Replay.Frames.Num();
+	LOG("TireBench replay %s (%s): %d substeps, %.1f ns/substep, %.1f sweeps/substep, %.2f allocs/substep",
+		*ReplayFile, *Replay.WheelName, Substeps, FPlatformTime::ToSeconds64(Cycles) * 1e9 / Substeps,
+		(float)Wheel->PendingStats.TotalTraces / Substeps, (float)CountingMalloc.Allocations.GetValue() / Substeps);
+
+	if (!CSVDirectory.IsEmpty()) {
+		const FString File = FPaths::Combine(CSVDirectory, FPaths::GetBaseFilename(ReplayFile) + TEXT(".csv"));
+		if (!FFileHelper::SaveStringToFile(CSV, *File)) {
+			LOGE("TireBench: couldn't write %s", *File);
+		}
+	}
+
+	if (World) {
+		World->RemoveFromRoot();
+	}
+
+	return 0;
+}
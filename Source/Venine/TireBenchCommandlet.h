@@ -0,0 +1,33 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "TireBenchCommandlet.generated.h"
+
+/**
+ * Headless fixed timestep bench of the UAdvancedWheelComponent force model against analytic grounds.
+ * Reports ns, sweeps and allocations per substep and optionally records every substep to CSV.
+ * Allocations are those of the bench thread, the force model makes none on other threads.
+ *
+ * UE4Editor-Cmd BikeTest.uproject -run=TireBench [-case=all|plane|step|bump|loop|ramp] [-substeps=2000] [-dt=0.002]
+ *     [-speed=500] [-mass=150] [-density=50] [-scalar] [-semiimplicit] [-csv=Saved/TireBench]
+ *
+ * -replay=<file> runs a recorded ride instead (one file per wheel, e.g. TireReplay_FrontWheel.trlp), against -map=<package> or the analytic -case (plane by default).
+ */
+UCLASS()
+class VENINE_API UTireBenchCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+
+	UTireBenchCommandlet();
+
+	virtual int32 Main(const FString &Params) override;
+
+private:
+
+	int32 RunReplay(const FString &Params, const FString &ReplayFile, int32 Density, const FString &CSVDirectory);
+};
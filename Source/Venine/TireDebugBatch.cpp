@@ -0,0 +1,59 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "TireDebugBatch.h"
+#include "Engine/World.h"
+
+#if ENABLE_DRAW_DEBUG
+
+void FTireDebugBatch::Reserve(int32 Lines, int32 Contacts)
+{
+	FScopeLock ScopeLock(&Lock);
+	SubstepLines.Reserve(Lines);
+	PublishedLines.Reserve(Lines);
+	SubstepContacts.Reserve(Contacts);
+	PublishedContacts.Reserve(Contacts);
+}
+
+void FTireDebugBatch::PublishSubstep()
+{
+	FScopeLock ScopeLock(&Lock);
+	Swap(SubstepLines, PublishedLines);
+	SubstepLines.Reset();
+	Swap(SubstepContacts, PublishedContacts);
+	SubstepContacts.Reset();
+	PublishedContactRadius = SubstepContactRadius;
+}
+
+void FTireDebugBatch::AddContactPoints(const FLinearColor &Color)
+{
+	// Kept past Flush, contacts are drawn every frame until a substep replaces them
+	FScopeLock ScopeLock(&Lock);
+	Points.Reserve(Points.Num() + PublishedContacts.Num());
+	for (const FVector &Contact : PublishedContacts) {
+		Points.Emplace(Contact, Color, PublishedContactRadius, 0, SDPG_World);
+	}
+}
+
+void FTireDebugBatch::Flush(UWorld *World)
+{
+	ULineBatchComponent *LineBatcher = World ? World->LineBatcher : nullptr;
+
+	if (LineBatcher) {
+		{
+			FScopeLock ScopeLock(&Lock);
+			if (PublishedLines.Num() > 0) {
+				LineBatcher->DrawLines(PublishedLines);
+				PublishedLines.Reset();
+			}
+		}
+
+		if (Points.Num() > 0) {
+			LineBatcher->BatchedPoints.Append(Points);
+			LineBatcher->MarkRenderStateDirty();
+		}
+	}
+
+	Points.Reset();
+}
+
+#endif
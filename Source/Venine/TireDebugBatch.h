@@ -0,0 +1,39 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/LineBatchComponent.h"
+#include "HAL/CriticalSection.h"
+
+/**
+ * Debug lines and points of one wheel, handed to the world's line batcher in one go per frame.
+ * Substep lines and contacts are written by whichever thread computes the wheel and only the last complete substep is shown.
+ * Compiles to nothing without ENABLE_DRAW_DEBUG.
+ */
+struct FTireDebugBatch
+{
+#if ENABLE_DRAW_DEBUG
+	// Owned by the substep being computed
+	TArray<FBatchedLine> SubstepLines;
+	// Owned by the substep being computed, trace sphere centers and radius
+	TArray<FVector> SubstepContacts;
+	float SubstepContactRadius = 0;
+	// Game thread only, sized by AddContactPoints
+	TArray<FBatchedPoint> Points;
+
+	// Keeps the substep and published buffers allocated, called from the thread that resizes the wheel
+	void Reserve(int32 Lines, int32 Contacts);
+	// Makes SubstepLines the lines drawn next frame and SubstepContacts the contacts read by AddContactPoints
+	void PublishSubstep();
+	// Game thread, adds a point per contact of the last published substep
+	void AddContactPoints(const FLinearColor &Color);
+	void Flush(UWorld *World);
+
+private:
+	TArray<FBatchedLine> PublishedLines;
+	TArray<FVector> PublishedContacts;
+	float PublishedContactRadius = 0;
+	FCriticalSection Lock;
+#endif
+};
@@ -0,0 +1,253 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+// Plain C++ tests of the tire model library, no engine needed: make -C Source/Venine/TireModel/Tests
+// UnrealBuildTool compiles every source of the module, the guard keeps this file and its main() out of it.
+#ifdef TIRE_MODEL_TESTS
+
+#include "../TireModel.h"
+#include <cmath>
+#include <cstdio>
+
+using namespace TireModel;
+
+namespace
+{
+
+const float TireTestTolerance = 1.e-3f;
+
+typedef void (*FTireTestFunction)();
+
+struct FTireTest {
+	const char *Name;
+	FTireTestFunction Function;
+};
+
+FTireTest Tests[32];
+int32_t TestCount = 0;
+int32_t Failures = 0;
+const char *CurrentTest = "";
+
+struct FTireTestRegistration {
+	FTireTestRegistration(const char *Name, FTireTestFunction Function) { Tests[TestCount++] = { Name, Function }; }
+};
+
+#define TIRE_MODEL_TEST(Name) \
+	void Name(); \
+	FTireTestRegistration Name##Registration(#Name, &Name); \
+	void Name()
+
+bool TestTrue(const char *What, bool Value)
+{
+	if (!Value) {
+		printf("  %s: %s failed\n", CurrentTest, What);
+		Failures++;
+	}
+	return Value;
+}
+
+bool TestEqual(const char *What, float Actual, float Expected, float Tolerance = TireTestTolerance)
+{
+	const bool Equal = std::fabs(Actual - Expected) <= Tolerance;
+	if (!Equal) {
+		printf("  %s: %s: expected %f, got %f\n", CurrentTest, What, Expected, Actual);
+		Failures++;
+	}
+	return Equal;
+}
+
+bool TestVector(const char *What, const FTireVector &Actual, const FTireVector &Expected)
+{
+	const bool Equal = (Actual - Expected).IsNearlyZero(TireTestTolerance);
+	if (!Equal) {
+		printf("  %s: %s: expected (%f, %f, %f), got (%f, %f, %f)\n", CurrentTest, What, Expected.X, Expected.Y, Expected.Z, Actual.X, Actual.Y, Actual.Z);
+		Failures++;
+	}
+	return Equal;
+}
+
+// Wheel at the origin rolling along X, axle along Y
+FTireTorus MakeTestTorus()
+{
+	FTireTorus Torus;
+	Torus.Forward = FTireVector(1, 0, 0);
+	Torus.Right = FTireVector(0, 1, 0);
+	Torus.InnerRadius = 25;
+	Torus.TubeRadius = 7;
+	return Torus;
+}
+
+// One lane resting on flat ground below the wheel, no motion
+void MakeTestLane(FTireForceLanes &Lanes, FTireKernelParams &Params, float Compression)
+{
+	Lanes.SetCapacity(1);
+	Lanes.Count = 1;
+	Lanes.Write(FTireForceLanes::RelX, 0, FTireVector(0, 0, -32));
+	// Normals point into the ground
+	Lanes.Write(FTireForceLanes::NormalX, 0, FTireVector(0, 0, -1));
+	Lanes.Stream(FTireForceLanes::Compression)[0] = Compression;
+	Lanes.Stream(FTireForceLanes::Weight)[0] = 1;
+
+	Params = FTireKernelParams();
+	Params.Body.Mass = 150;
+	Params.WheelRight = FTireVector(0, 1, 0);
+	Params.SpringScale = -50000000.f / 500;
+	Params.DampScale = -10000.f / 500;
+	Params.VelocityMul = 200000;
+	Params.EnginePower = 0;
+	Params.BreakPower = 0;
+	Params.PressurePower = 1;
+	Params.PressurePreload = .2f;
+	Params.SpringCap = 200000;
+	Params.DampCap = 500000;
+	Params.SemiImplicit = false;
+	Params.Timestep = .002f;
+	Params.SampleMass = 150.f / 500;
+	Params.CompressionLength = 7 * 2.2f;
+}
+
+TIRE_MODEL_TEST(RingDirection)
+{
+	const FTireTorus Torus = MakeTestTorus();
+
+	TestVector("Ring at 0", GetRingDirection(Torus, 0), Torus.Forward);
+	TestVector("Ring at 180", GetRingDirection(Torus, 180), -Torus.Forward);
+	TestVector("Ring at 360", GetRingDirection(Torus, 360), Torus.Forward);
+
+	for (float Angle = 0; Angle < 360; Angle += 15) {
+		const FTireVector Direction = GetRingDirection(Torus, Angle);
+		TestEqual("Ring direction is unit", Direction.Size(), 1.f);
+		TestEqual("Ring direction is off the axle", FTireVector::Dot(Direction, Torus.Right), 0.f);
+	}
+}
+
+TIRE_MODEL_TEST(SampleSegment)
+{
+	const FTireTorus Torus = MakeTestTorus();
+	const FTireVector Down = GetRingDirection(Torus, 90);
+	const FTireVector TubeCenter = Down * Torus.InnerRadius;
+
+	FTireVector Start, Tread, Direction;
+	GetSampleSegment(Torus, Down, 0, Start, Tread, Direction);
+	TestVector("Center sample start", Start, Down * (Torus.InnerRadius - Torus.TubeRadius * 1.2f));
+	TestVector("Center sample tread", Tread, Down * (Torus.InnerRadius + Torus.TubeRadius));
+
+	// Off center samples sweep the tube's cross section, toward either side of the axle
+	GetSampleSegment(Torus, Down, 90, Start, Tread, Direction);
+	TestEqual("Side sample reaches the axle direction", std::fabs(FTireVector::Dot(Tread - TubeCenter, Torus.Right)), Torus.TubeRadius);
+
+	for (float Angle = -135; Angle <= 135; Angle += 27) {
+		GetSampleSegment(Torus, Down, Angle, Start, Tread, Direction);
+		TestVector("Tread is along the sweep direction", Tread, TubeCenter + Direction * Torus.TubeRadius);
+		TestEqual("Sweep direction is unit", Direction.Size(), 1.f);
+		TestEqual("Tread is on the tube", (Tread - TubeCenter).Size(), Torus.TubeRadius);
+		TestEqual("Tread stays in the ring's cross section", FTireVector::Dot(Tread - TubeCenter, FTireVector::Cross(Down, Torus.Right)), 0.f);
+		TestVector("Start is shared by the ring", Start, Down * (Torus.InnerRadius - Torus.TubeRadius * 1.2f));
+	}
+}
+
+TIRE_MODEL_TEST(SpringForce)
+{
+	FTireForceLanes Lanes;
+	FTireKernelParams Params;
+
+	// Explicit: pressure along the ground normal, half way through the filter on the first substep
+	MakeTestLane(Lanes, Params, .001f);
+	TestTrue("No lane dropped", ComputeLaneForces(Lanes, Params) == 0);
+	const float Pressure = (1 - std::pow(1 - .001f, Params.PressurePower)) * (1 - Params.PressurePreload) + Params.PressurePreload;
+	TestVector("Explicit spring", Lanes.Read(FTireForceLanes::SpringX, 0), FTireVector(0, 0, -Params.SpringScale * Pressure * .5f));
+	TestVector("Resting damping", Lanes.Read(FTireForceLanes::DampingX, 0), FTireVector());
+	TestVector("Resting friction", Lanes.Read(FTireForceLanes::FrictionX, 0), FTireVector());
+	TestEqual("Explicit spring under its cap", Lanes.Stream(FTireForceLanes::Capped)[0], 0.f);
+
+	// Deep compression of a stiff tire hits the cap
+	MakeTestLane(Lanes, Params, .9f);
+	Params.SpringScale *= 10;
+	ComputeLaneForces(Lanes, Params);
+	TestEqual("Deep compression is capped", Lanes.Stream(FTireForceLanes::Capped)[0], 1.f);
+	TestEqual("Capped spring, filtered", Lanes.Stream(FTireForceLanes::SpringSize)[0], Params.SpringCap * .5f, 1.f);
+
+	// Semi implicit: same direction, never capped, softened by the implicit denominator
+	MakeTestLane(Lanes, Params, .9f);
+	Params.SemiImplicit = true;
+	ComputeLaneForces(Lanes, Params);
+	const FTireVector Spring = Lanes.Read(FTireForceLanes::SpringX, 0);
+	TestTrue("Semi implicit spring pushes the wheel up", Spring.Z > 0 && std::fabs(Spring.X) < TireTestTolerance && std::fabs(Spring.Y) < TireTestTolerance);
+	TestTrue("Semi implicit spring below the explicit one", Spring.Z < -Params.SpringScale * (.9f * (1 - Params.PressurePreload) + Params.PressurePreload));
+	TestEqual("Semi implicit is never capped", Lanes.Stream(FTireForceLanes::Capped)[0], 0.f);
+}
+
+TIRE_MODEL_TEST(Friction)
+{
+	FTireForceLanes Lanes;
+	FTireKernelParams Params;
+
+	// Sliding sideways, friction opposes the lateral velocity
+	MakeTestLane(Lanes, Params, .1f);
+	Params.Body.LinearVelocity = FTireVector(0, 10, 0);
+	ComputeLaneForces(Lanes, Params);
+	TestEqual("Lateral speed", Lanes.Stream(FTireForceLanes::LateralSpeed)[0], 10.f);
+	TestVector("Lateral friction, filtered", Lanes.Read(FTireForceLanes::FrictionX, 0), FTireVector(0, -10 * Params.VelocityMul * .2f, 0));
+
+	// Engine power drives along the contact's forward direction
+	MakeTestLane(Lanes, Params, .1f);
+	Params.EnginePower = 1000;
+	ComputeLaneForces(Lanes, Params);
+	const FTireVector Friction = Lanes.Read(FTireForceLanes::FrictionX, 0);
+	TestEqual("Engine friction along forward", std::fabs(Friction.X), Params.EnginePower * .2f);
+	TestTrue("Engine friction stays in the contact plane", std::fabs(Friction.Y) < TireTestTolerance && std::fabs(Friction.Z) < TireTestTolerance);
+}
+
+TIRE_MODEL_TEST(NonFiniteLanes)
+{
+	FTireForceLanes Lanes;
+	FTireKernelParams Params;
+
+	MakeTestLane(Lanes, Params, .1f);
+	Lanes.Write(FTireForceLanes::NormalX, 0, FTireVector(NAN, 0, -1));
+	Lanes.Write(FTireForceLanes::SpringX, 0, FTireVector(1, 2, 3));
+
+	TestTrue("Non finite lane dropped", ComputeLaneForces(Lanes, Params) == 1);
+	TestVector("Dropped lane spring", Lanes.Read(FTireForceLanes::SpringX, 0), FTireVector());
+	TestVector("Dropped lane friction", Lanes.Read(FTireForceLanes::FrictionX, 0), FTireVector());
+
+	const FTireWrench Wrench = ComputeNetWrench(Lanes, 1);
+	TestTrue("Wrench stays finite", !Wrench.Force.ContainsNaN() && !Wrench.Torque.ContainsNaN());
+}
+
+TIRE_MODEL_TEST(NetWrench)
+{
+	FTireForceLanes Lanes;
+	Lanes.SetCapacity(2);
+	Lanes.Count = 2;
+
+	// Friction is averaged over the hit weight, springs and damping are not
+	for (int32_t Lane = 0; Lane < 2; Lane++) {
+		Lanes.Write(FTireForceLanes::RelX, Lane, FTireVector(Lane ? 10.f : -10.f, 0, -32));
+		Lanes.Write(FTireForceLanes::FrictionX, Lane, FTireVector(100, 0, 0));
+		Lanes.Write(FTireForceLanes::SpringX, Lane, FTireVector(0, 0, 1000));
+		Lanes.Write(FTireForceLanes::DampingX, Lane, FTireVector(0, 0, 10));
+		Lanes.Stream(FTireForceLanes::Weight)[Lane] = 2;
+	}
+
+	const FTireWrench Wrench = ComputeNetWrench(Lanes, 4);
+	TestVector("Net force", Wrench.Force, FTireVector(100 * 2 * 2 / 4.f, 0, 1010 * 2 * 2));
+	// Springs cancel out around the center, friction below it pitches the wheel
+	TestVector("Net torque", Wrench.Torque, FTireVector(0, -32 * 100 * 2 * 2 / 4.f, 0));
+}
+
+}
+
+int main()
+{
+	for (int32_t Index = 0; Index < TestCount; Index++) {
+		const int32_t FailuresBefore = Failures;
+		CurrentTest = Tests[Index].Name;
+		Tests[Index].Function();
+		printf("%s %s\n", Failures > FailuresBefore ? "FAIL" : "ok  ", CurrentTest);
+	}
+
+	printf("%d tests, %d failed checks\n", TestCount, Failures);
+	return Failures > 0 ? 1 : 0;
+}
+
+#endif
@@ -0,0 +1,143 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "TireModel.h"
+
+namespace TireModel
+{
+
+FTireVector GetRingDirection(const FTireTorus &Torus, float ToroidalAngle)
+{
+	return Torus.Forward.RotateAngleAxis(ToroidalAngle, Torus.Right);
+}
+
+void GetSampleSegment(const FTireTorus &Torus, const FTireVector &RingDirection, float PoloidalAngle, FTireVector &OutStart, FTireVector &OutTread, FTireVector &OutDirection)
+{
+	const FTireVector TubeCenter = Torus.Position + RingDirection * Torus.InnerRadius;
+	const FTireVector PoloidalAxis = FTireVector::Cross(RingDirection, Torus.Right).GetSafeNormal();
+	OutDirection = RingDirection.RotateAngleAxis(PoloidalAngle, PoloidalAxis);
+
+	OutStart = TubeCenter - RingDirection * (Torus.TubeRadius * 1.2f);
+	OutTread = TubeCenter + OutDirection * Torus.TubeRadius;
+}
+
+void FTireForceLanes::SetCapacity(int32_t Num)
+{
+	Capacity = (std::max(Num, 1) + Width - 1) / Width * Width;
+	Count = 0;
+	Data.assign((size_t)Capacity * NumStreams, 0.f);
+}
+
+int32_t ComputeLaneForces(FTireForceLanes &Lanes, const FTireKernelParams &Params)
+{
+	int32_t Dropped = 0;
+
+	for (int32_t Lane = 0; Lane < Lanes.Count; Lane++) {
+
+		const FTireVector PatchNormal = Lanes.Read(FTireForceLanes::NormalX, Lane);
+		const float Compression = Lanes.Stream(FTireForceLanes::Compression)[Lane];
+		const FTireVector Velocity = Params.Body.LinearVelocity + FTireVector::Cross(Params.Body.AngularVelocity, Lanes.Read(FTireForceLanes::RelX, Lane));
+
+		/************ FRICTION ************/
+		const FTireVector LateralVector = FTireVector::VectorPlaneProject(Params.WheelRight, PatchNormal).GetSafeNormal();
+		const FTireVector ForwardVector = FTireVector::Cross(PatchNormal, LateralVector).GetSafeNormal();
+
+		// A non finite contact frame would poison the filters and the body, drop the lane and let the caller report it
+		if (LateralVector.ContainsNaN() || ForwardVector.ContainsNaN() || Velocity.ContainsNaN() || !std::isfinite(Compression)) {
+			const FTireVector Zero;
+			Lanes.Write(FTireForceLanes::FrictionX, Lane, Zero);
+			Lanes.Write(FTireForceLanes::SpringX, Lane, Zero);
+			Lanes.Write(FTireForceLanes::DampingX, Lane, Zero);
+			Lanes.Stream(FTireForceLanes::FrictionSize)[Lane] = 0;
+			Lanes.Stream(FTireForceLanes::LateralSpeed)[Lane] = 0;
+			Lanes.Stream(FTireForceLanes::SpringSize)[Lane] = 0;
+			Lanes.Stream(FTireForceLanes::DampingSize)[Lane] = 0;
+			Lanes.Stream(FTireForceLanes::Grip)[Lane] = 0;
+			Lanes.Stream(FTireForceLanes::Capped)[Lane] = 0;
+			Dropped++;
+			continue;
+		}
+		const FTireVector LateralVelocity = Velocity.ProjectOnToNormal(LateralVector);
+		const FTireVector ForwardVelocity = Velocity.ProjectOnToNormal(ForwardVector);
+
+		FTireVector FrictionForce = (LateralVelocity * -Params.VelocityMul) + (ForwardVector * Params.EnginePower) + (ForwardVelocity * -(Params.BreakPower + 5.f));
+		if (Params.SlipTable) FrictionForce *= Params.SlipTable->Evaluate(LateralVelocity.Size());
+
+		Lanes.Stream(FTireForceLanes::LateralSpeed)[Lane] = LateralVelocity.Size();
+		Lanes.Stream(FTireForceLanes::FrictionSize)[Lane] = FrictionForce.Size();
+
+		// FILTERING FRICTION STACK
+		FrictionForce = FTireVector::Lerp(Lanes.Read(FTireForceLanes::FrictionX, Lane), FrictionForce, .2f);
+		Lanes.Write(FTireForceLanes::FrictionX, Lane, FrictionForce);
+		/*********************************/
+
+		/************ TIRE PUSH ************/
+		if (Params.GripTable) {
+			Lanes.Stream(FTireForceLanes::Grip)[Lane] = Params.GripTable->Evaluate(Compression);
+		} else {
+			Lanes.Stream(FTireForceLanes::Grip)[Lane] = (1.f - std::pow(1 - Compression, 5.f))*.8f + .2f;
+		}
+
+		const float TireCompression = Params.PressureTable ? Params.PressureTable->Evaluate(Compression) : (1 - std::pow(1 - Compression, Params.PressurePower))*(1.f - Params.PressurePreload) + Params.PressurePreload;
+
+		if (Params.SemiImplicit) {
+			// Backward Euler on the spring-damper along the normal, linearized around the current compression.
+			// F = (-S - (c + h k) Vn) / (1 + h c / m + h^2 k / m), stable at any substep so no cap or filter
+			const float PressureSlope = Params.PressureTable ? Params.PressureTable->Slope(Compression) : Params.PressurePower * std::pow(1 - Compression, Params.PressurePower - 1) * (1.f - Params.PressurePreload);
+			const float Spring = -Params.SpringScale * TireCompression;
+			const float Stiffness = -Params.SpringScale * PressureSlope / Params.CompressionLength;
+			const float Damping = -Params.DampScale * TireCompression;
+			const float NormalSpeed = FTireVector::Dot(Velocity, PatchNormal);
+			const float h = Params.Timestep;
+			const float InvDenominator = 1.f / (1.f + (h * Damping + h * h * Stiffness) / Params.SampleMass);
+
+			const FTireVector PressureForce = PatchNormal * (-Spring * InvDenominator);
+			const FTireVector DampingForce = PatchNormal * (-(Damping + h * Stiffness) * NormalSpeed * InvDenominator);
+
+			Lanes.Stream(FTireForceLanes::Capped)[Lane] = 0;
+			Lanes.Write(FTireForceLanes::SpringX, Lane, PressureForce);
+			Lanes.Write(FTireForceLanes::DampingX, Lane, DampingForce);
+			Lanes.Stream(FTireForceLanes::SpringSize)[Lane] = PressureForce.Size();
+			Lanes.Stream(FTireForceLanes::DampingSize)[Lane] = DampingForce.Size();
+			continue;
+		}
+
+		const FTireVector PoloidalDelta = Velocity.ProjectOnTo(PatchNormal);
+
+		FTireVector PressureForce = PatchNormal * (Params.SpringScale * TireCompression);
+		FTireVector DampingForce = PoloidalDelta * (Params.DampScale * TireCompression);
+
+		PressureForce = PressureForce.GetClampedToMaxSize(Params.SpringCap);
+		DampingForce = DampingForce.GetClampedToMaxSize(Params.DampCap);
+
+		Lanes.Stream(FTireForceLanes::Capped)[Lane] = (PressureForce.Size() == Params.SpringCap ? 1 : 0) + (DampingForce.Size() == Params.DampCap ? 2 : 0);
+
+		// FILTERING SPRING STACK
+		PressureForce = FTireVector::Lerp(Lanes.Read(FTireForceLanes::SpringX, Lane), PressureForce, .5f);
+		DampingForce = FTireVector::Lerp(Lanes.Read(FTireForceLanes::DampingX, Lane), DampingForce, .5f);
+
+		Lanes.Write(FTireForceLanes::SpringX, Lane, PressureForce);
+		Lanes.Write(FTireForceLanes::DampingX, Lane, DampingForce);
+
+		Lanes.Stream(FTireForceLanes::SpringSize)[Lane] = PressureForce.Size();
+		Lanes.Stream(FTireForceLanes::DampingSize)[Lane] = DampingForce.Size();
+		/************************************/
+	}
+
+	return Dropped;
+}
+
+FTireWrench ComputeNetWrench(const FTireForceLanes &Lanes, float TotalHitWeight)
+{
+	// Friction is averaged over the hit area, springs are already scaled per sample
+	const float FrictionScale = 1.f / TotalHitWeight;
+
+	FTireWrench Wrench;
+	for (int32_t Lane = 0; Lane < Lanes.Count; Lane++) {
+		const FTireVector Force = (Lanes.Read(FTireForceLanes::FrictionX, Lane) * FrictionScale + Lanes.Read(FTireForceLanes::SpringX, Lane) + Lanes.Read(FTireForceLanes::DampingX, Lane)) * Lanes.Stream(FTireForceLanes::Weight)[Lane];
+		Wrench.Force += Force;
+		Wrench.Torque += FTireVector::Cross(Lanes.Read(FTireForceLanes::RelX, Lane), Force);
+	}
+	return Wrench;
+}
+
+}
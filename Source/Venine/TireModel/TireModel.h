@@ -0,0 +1,147 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "TireVector.h"
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Engine agnostic tire geometry and force math. Plain data in, plain data out, no scene queries or physics bodies:
+ * callers sweep the samples against their own world and apply the resulting forces to their own body.
+ * Builds without the engine: g++ -std=c++14 -c TireModel.cpp, tests run with make -C Tests test
+ */
+namespace TireModel
+{
+
+// Rigid body state read once per substep, point velocities are V + W x (P - CenterOfMass)
+struct FTireBody {
+	FTireVector CenterOfMass;
+	FTireVector LinearVelocity;
+	FTireVector AngularVelocity;
+	float Mass = 1;
+
+	FTireVector GetVelocityAt(const FTireVector &Point) const { return LinearVelocity + FTireVector::Cross(AngularVelocity, Point - CenterOfMass); }
+};
+
+// Torus the samples are laid on, InnerRadius to the tube center and TubeRadius around it
+struct FTireTorus {
+	FTireVector Position;
+	FTireVector Forward;
+	FTireVector Right;
+	float InnerRadius = 25;
+	float TubeRadius = 7;
+};
+
+// Unit direction from the wheel center to a ring, ToroidalAngle in degrees around Right from Forward
+FTireVector GetRingDirection(const FTireTorus &Torus, float ToroidalAngle);
+
+// Sweep segment of one sample, from inside the tube through the tread point at PoloidalAngle degrees off the ring direction.
+// OutDirection is the unit direction from the tube center to the tread point, sweeps extend past the tread along it.
+void GetSampleSegment(const FTireTorus &Torus, const FTireVector &RingDirection, float PoloidalAngle, FTireVector &OutStart, FTireVector &OutTread, FTireVector &OutDirection);
+
+// Response uniformly sampled over [0, Range], read with one interpolated load
+struct FTireResponseTable {
+	static const int32_t Size = 256;
+
+	// Last entry repeated so the upper neighbour always exists
+	float Values[Size + 1] = {};
+	float Range = 1;
+	float InvStep = Size - 1;
+
+	template<typename ResponseType>
+	void Bake(float InRange, ResponseType Response)
+	{
+		Range = InRange;
+		InvStep = (Size - 1) / Range;
+
+		for (int32_t Index = 0; Index < Size; Index++) {
+			Values[Index] = Response(Index * Range / (Size - 1));
+		}
+		Values[Size] = Values[Size - 1];
+	}
+
+	inline float Evaluate(float X) const
+	{
+		const float Position = std::min(std::max(X * InvStep, 0.f), (float)(Size - 1));
+		const int32_t Index = (int32_t)Position;
+		return Values[Index] + (Values[Index + 1] - Values[Index]) * (Position - Index);
+	}
+
+	// Derivative of the interpolated response at X
+	inline float Slope(float X) const
+	{
+		const int32_t Index = std::min(std::max((int32_t)(X * InvStep), 0), Size - 2);
+		return (Values[Index + 1] - Values[Index]) * InvStep;
+	}
+};
+
+// Compacted hit samples, one float stream per component, padded to the SIMD width
+struct FTireForceLanes {
+	enum EStream {
+		RelX, RelY, RelZ,					// Contact point relative to the center of mass
+		NormalX, NormalY, NormalZ,
+		Compression,
+		Weight,								// Reference samples this lane stands for
+		FrictionX, FrictionY, FrictionZ,	// Filtered, read and written back
+		SpringX, SpringY, SpringZ,			// Filtered, read and written back
+		DampingX, DampingY, DampingZ,		// Filtered, read and written back
+		FrictionSize,						// Unfiltered friction magnitude
+		LateralSpeed,
+		SpringSize,
+		DampingSize,
+		Grip,
+		Capped,								// 1 spring hit cap, 2 damping hit cap
+		NumStreams
+	};
+
+	static const int32_t Width = 4;
+
+	std::vector<float> Data;
+	int32_t Capacity = 0;
+	int32_t Count = 0;
+
+	void SetCapacity(int32_t Num);
+	float *Stream(EStream S) { return Data.data() + S * Capacity; }
+	const float *Stream(EStream S) const { return Data.data() + S * Capacity; }
+
+	FTireVector Read(EStream S, int32_t Lane) const { return FTireVector(Stream(S)[Lane], Stream((EStream)(S + 1))[Lane], Stream((EStream)(S + 2))[Lane]); }
+	void Write(EStream S, int32_t Lane, const FTireVector &V) { Stream(S)[Lane] = V.X; Stream((EStream)(S + 1))[Lane] = V.Y; Stream((EStream)(S + 2))[Lane] = V.Z; }
+};
+
+struct FTireKernelParams {
+	FTireBody Body;
+	FTireVector WheelRight;
+	float SpringScale;	// -Kp / TotalTraceDensity
+	float DampScale;	// -Kd / TotalTraceDensity
+	float VelocityMul;
+	float EnginePower;
+	float BreakPower;
+	float PressurePower;
+	float PressurePreload;
+	float SpringCap;
+	float DampCap;
+	bool SemiImplicit;
+	float Timestep;
+	float SampleMass;			// Sprung mass per unit of sample weight
+	float CompressionLength;	// Distance over which compression goes from 0 to 1
+	// Replace the analytic pressure, grip and friction curves when set
+	const FTireResponseTable *PressureTable = nullptr;
+	const FTireResponseTable *GripTable = nullptr;
+	const FTireResponseTable *SlipTable = nullptr;
+};
+
+// Friction, spring and damping of every lane, reference implementation one lane at a time.
+// Returns the number of lanes with a non finite contact frame, their forces are zeroed.
+int32_t ComputeLaneForces(FTireForceLanes &Lanes, const FTireKernelParams &Params);
+
+struct FTireWrench {
+	FTireVector Force;
+	FTireVector Torque;
+};
+
+// Sum of the weighted lane forces and their torque about the center of mass, friction averaged over TotalHitWeight
+FTireWrench ComputeNetWrench(const FTireForceLanes &Lanes, float TotalHitWeight);
+
+}
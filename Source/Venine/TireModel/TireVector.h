@@ -0,0 +1,65 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include <cmath>
+
+namespace TireModel
+{
+
+// Minimal 3D vector, same conventions as FVector (angles in degrees, safe normals are zero when degenerate)
+struct FTireVector {
+	float X = 0;
+	float Y = 0;
+	float Z = 0;
+
+	FTireVector() {}
+	FTireVector(float InX, float InY, float InZ) : X(InX), Y(InY), Z(InZ) {}
+
+	FTireVector operator+(const FTireVector &V) const { return FTireVector(X + V.X, Y + V.Y, Z + V.Z); }
+	FTireVector operator-(const FTireVector &V) const { return FTireVector(X - V.X, Y - V.Y, Z - V.Z); }
+	FTireVector operator-() const { return FTireVector(-X, -Y, -Z); }
+	FTireVector operator*(float Scale) const { return FTireVector(X * Scale, Y * Scale, Z * Scale); }
+	FTireVector operator/(float Scale) const { return *this * (1.f / Scale); }
+	FTireVector &operator+=(const FTireVector &V) { X += V.X; Y += V.Y; Z += V.Z; return *this; }
+	FTireVector &operator-=(const FTireVector &V) { X -= V.X; Y -= V.Y; Z -= V.Z; return *this; }
+	FTireVector &operator*=(float Scale) { X *= Scale; Y *= Scale; Z *= Scale; return *this; }
+
+	static float Dot(const FTireVector &A, const FTireVector &B) { return A.X * B.X + A.Y * B.Y + A.Z * B.Z; }
+	static FTireVector Cross(const FTireVector &A, const FTireVector &B) { return FTireVector(A.Y * B.Z - A.Z * B.Y, A.Z * B.X - A.X * B.Z, A.X * B.Y - A.Y * B.X); }
+	static FTireVector Lerp(const FTireVector &A, const FTireVector &B, float Alpha) { return A + (B - A) * Alpha; }
+
+	float SizeSquared() const { return Dot(*this, *this); }
+	float Size() const { return std::sqrt(SizeSquared()); }
+	bool IsNearlyZero(float Tolerance = 1.e-4f) const { return std::fabs(X) <= Tolerance && std::fabs(Y) <= Tolerance && std::fabs(Z) <= Tolerance; }
+	bool ContainsNaN() const { return !std::isfinite(X) || !std::isfinite(Y) || !std::isfinite(Z); }
+
+	FTireVector GetSafeNormal(float Tolerance = 1.e-8f) const
+	{
+		const float Squared = SizeSquared();
+		return Squared < Tolerance ? FTireVector() : *this * (1.f / std::sqrt(Squared));
+	}
+
+	FTireVector GetClampedToMaxSize(float MaxSize) const
+	{
+		const float Squared = SizeSquared();
+		return Squared > MaxSize * MaxSize ? *this * (MaxSize / std::sqrt(Squared)) : *this;
+	}
+
+	FTireVector ProjectOnTo(const FTireVector &A) const { return A * (Dot(*this, A) / A.SizeSquared()); }
+	FTireVector ProjectOnToNormal(const FTireVector &Normal) const { return Normal * Dot(*this, Normal); }
+	static FTireVector VectorPlaneProject(const FTireVector &V, const FTireVector &PlaneNormal) { return V - V.ProjectOnToNormal(PlaneNormal); }
+
+	// Rodrigues rotation around a unit axis
+	FTireVector RotateAngleAxis(float AngleDeg, const FTireVector &Axis) const
+	{
+		const float Radians = AngleDeg * 3.14159265358979f / 180.f;
+		const float S = std::sin(Radians);
+		const float C = std::cos(Radians);
+		return *this * C + Cross(Axis, *this) * S + Axis * (Dot(Axis, *this) * (1.f - C));
+	}
+};
+
+inline FTireVector operator*(float Scale, const FTireVector &V) { return V * Scale; }
+
+}
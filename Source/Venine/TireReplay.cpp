@@ -0,0 +1,73 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "TireReplay.h"
+#include "HAL/FileManager.h"
+#include "Misc/Paths.h"
+#include "Serialization/Archive.h"
+
+#define LOG(format, ...) UE_LOG(LogTemp, Log, TEXT(format), __VA_ARGS__)
+#define LOGW(format, ...) UE_LOG(LogTemp, Warning, TEXT(format), __VA_ARGS__)
+#define LOGE(format, ...) UE_LOG(LogTemp, Error, TEXT(format), __VA_ARGS__)
+
+FArchive &operator<<(FArchive &Ar, FTireReplayFrame &Frame)
+{
+	Ar << Frame.WheelTransform;
+	Ar << Frame.CenterOfMass << Frame.LinearVelocity << Frame.AngularVelocity;
+	Ar << Frame.Mass << Frame.DeltaTime << Frame.EnginePower << Frame.BreakPower;
+	Ar << Frame.LOD;
+	return Ar;
+}
+
+FString FTireReplay::GetPath(const FString &Filename)
+{
+	return FPaths::IsRelative(Filename) ? FPaths::ProjectSavedDir() / TEXT("Replays") / Filename : Filename;
+}
+
+FString FTireReplay::GetWheelFilename(const FString &ReplayFile, const FString &WheelName)
+{
+	return FString::Printf(TEXT("%s_%s.trlp"), *FPaths::ChangeExtension(ReplayFile, TEXT("")), *WheelName);
+}
+
+bool FTireReplay::Save(const FString &Filename)
+{
+	TUniquePtr<FArchive> Ar(IFileManager::Get().CreateFileWriter(*GetPath(Filename)));
+	if (!Ar) {
+		LOGE("REPLAY : couldn't write %s", *GetPath(Filename));
+		return false;
+	}
+
+	uint32 FileMagic = Magic;
+	uint32 FileVersion = Version;
+	*Ar << FileMagic << FileVersion << WheelName << Frames;
+
+	return Ar->Close();
+}
+
+bool FTireReplay::Load(const FString &Filename, const FString &ExpectedWheelName)
+{
+	TUniquePtr<FArchive> Ar(IFileManager::Get().CreateFileReader(*GetPath(Filename)));
+	if (!Ar) {
+		LOGE("REPLAY : couldn't read %s", *GetPath(Filename));
+		return false;
+	}
+
+	uint32 FileMagic = 0;
+	uint32 FileVersion = 0;
+	*Ar << FileMagic << FileVersion;
+	if (FileMagic != Magic || FileVersion != Version) {
+		LOGE("REPLAY : %s is not a version %d tire replay", *GetPath(Filename), Version);
+		return false;
+	}
+
+	FString FileWheelName;
+	*Ar << FileWheelName;
+	if (!ExpectedWheelName.IsEmpty() && FileWheelName != ExpectedWheelName) {
+		LOGE("REPLAY : %s was recorded on %s, not %s", *GetPath(Filename), *FileWheelName, *ExpectedWheelName);
+		return false;
+	}
+
+	WheelName = FileWheelName;
+	*Ar << Frames;
+
+	return !Ar->IsError();
+}
@@ -0,0 +1,45 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Everything the tire model reads from the world and the player for one substep, in world space
+struct FTireReplayFrame {
+	FTransform WheelTransform;
+	FVector CenterOfMass = FVector::ZeroVector;
+	FVector LinearVelocity = FVector::ZeroVector;
+	FVector AngularVelocity = FVector::ZeroVector;
+	float Mass = 1;
+	float DeltaTime = 0;
+	float EnginePower = 0;
+	float BreakPower = 0;
+	// ETireLOD the substep ran at
+	uint8 LOD = 0;
+
+	friend FArchive &operator<<(FArchive &Ar, FTireReplayFrame &Frame);
+};
+
+/**
+ * Per substep inputs of one wheel over a ride, replayed through the tire model to get the exact same workload again.
+ * File layout: "TRLP", version, wheel name, frames.
+ */
+class VENINE_API FTireReplay
+{
+public:
+
+	FString WheelName;
+	TArray<FTireReplayFrame> Frames;
+
+	bool Save(const FString &Filename);
+	// Fails on a recording of another wheel unless ExpectedWheelName is empty
+	bool Load(const FString &Filename, const FString &ExpectedWheelName = FString());
+
+	// Relative names live in Saved/Replays
+	static FString GetPath(const FString &Filename);
+	// One file per wheel: <ReplayFile>_<WheelName>.trlp
+	static FString GetWheelFilename(const FString &ReplayFile, const FString &WheelName);
+
+	static const uint32 Magic = 0x504C5254;
+	static const uint32 Version = 2;
+};
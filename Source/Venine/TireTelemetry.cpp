@@ -0,0 +1,124 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "TireTelemetry.h"
+#include "HAL/PlatformFilemanager.h"
+#include "HAL/RunnableThread.h"
+#include "GenericPlatform/GenericPlatformFile.h"
+#include "Misc/Paths.h"
+
+#define LOG(format, ...) UE_LOG(LogTemp, Log, TEXT(format), __VA_ARGS__)
+#define LOGW(format, ...) UE_LOG(LogTemp, Warning, TEXT(format), __VA_ARGS__)
+#define LOGE(format, ...) UE_LOG(LogTemp, Error, TEXT(format), __VA_ARGS__)
+
+FTireTelemetryRing::FTireTelemetryRing(int32 InCapacity)
+{
+	const int32 Capacity = FMath::RoundUpToPowerOfTwo(FMath::Max(InCapacity, 2));
+	Slots.SetNum(Capacity);
+	Mask = Capacity - 1;
+}
+
+void FTireTelemetryRing::Push(const FTireTelemetryRecord &Record)
+{
+	// Only this thread writes Head
+	const int64 Index = Head;
+	FSlot &Slot = Slots[Index & Mask];
+
+	FPlatformAtomics::InterlockedExchange(&Slot.Sequence, Index * 2 + 1);
+	Slot.Record = Record;
+	FPlatformMisc::MemoryBarrier();
+	FPlatformAtomics::InterlockedExchange(&Slot.Sequence, Index * 2 + 2);
+
+	FPlatformAtomics::InterlockedExchange(&Head, Index + 1);
+}
+
+int32 FTireTelemetryRing::Read(uint64 &Cursor, TArray<FTireTelemetryRecord> &Out) const
+{
+	const uint64 Written = GetHead();
+	const uint64 Capacity = Mask + 1;
+	int32 Lost = 0;
+
+	// Everything older than one lap is gone
+	if (Written - Cursor > Capacity) {
+		Lost += Written - Capacity - Cursor;
+		Cursor = Written - Capacity;
+	}
+
+	for (; Cursor < Written; Cursor++) {
+		const FSlot &Slot = Slots[Cursor & Mask];
+		const int64 Complete = (int64)Cursor * 2 + 2;
+
+		const int64 Before = FPlatformAtomics::AtomicRead(&Slot.Sequence);
+		FPlatformMisc::MemoryBarrier();
+		const FTireTelemetryRecord Record = Slot.Record;
+		FPlatformMisc::MemoryBarrier();
+		const int64 After = FPlatformAtomics::AtomicRead(&Slot.Sequence);
+
+		if (Before == Complete && After == Complete) {
+			Out.Add(Record);
+		} else {
+			Lost++;
+		}
+	}
+
+	return Lost;
+}
+
+FTireTelemetryWriter::FTireTelemetryWriter(const FTireTelemetryRing &InRing, const FString &InFilename)
+	: Ring(InRing)
+	, Filename(InFilename)
+{
+	IPlatformFile &PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	PlatformFile.CreateDirectoryTree(*FPaths::GetPath(Filename));
+	File = PlatformFile.OpenWrite(*Filename);
+
+	if (!File) {
+		LOGE("TELEMETRY : couldn't open %s", *Filename);
+		return;
+	}
+
+	const uint32 Header[] = { Magic, Version, sizeof(FTireTelemetryRecord) };
+	File->Write((const uint8*)Header, sizeof(Header));
+
+	// Records published before the writer opened belong to no file, the first Drain starts at the current head
+	Cursor = Ring.GetHead();
+	Thread = FRunnableThread::Create(this, TEXT("TireTelemetryWriter"), 0, TPri_BelowNormal);
+}
+
+FTireTelemetryWriter::~FTireTelemetryWriter()
+{
+	if (Thread) {
+		Thread->Kill(true);
+		delete Thread;
+	}
+
+	if (File) {
+		Drain();
+		delete File;
+
+		if (Lost > 0) LOGW("TELEMETRY : %lld records lost in %s", Lost, *Filename);
+	}
+}
+
+uint32 FTireTelemetryWriter::Run()
+{
+	while (!Stopping) {
+		Drain();
+		FPlatformProcess::Sleep(.05f);
+	}
+	return 0;
+}
+
+void FTireTelemetryWriter::Stop()
+{
+	Stopping = true;
+}
+
+void FTireTelemetryWriter::Drain()
+{
+	Buffer.Reset();
+	Lost += Ring.Read(Cursor, Buffer);
+
+	if (Buffer.Num() > 0) {
+		File->Write((const uint8*)Buffer.GetData(), Buffer.Num() * sizeof(FTireTelemetryRecord));
+	}
+}
@@ -0,0 +1,103 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+#include "HAL/ThreadSafeBool.h"
+
+class FRunnableThread;
+class IFileHandle;
+
+// One physics substep of one wheel, written as is to capture files
+struct FTireTelemetryRecord {
+	uint64 Frame = 0;
+	float DeltaTime = 0;
+	float ComputeMicroseconds = 0;
+
+	uint16 Substep = 0;
+	uint16 HitSamples = 0;
+	uint16 Sweeps = 0;
+	uint16 ReusedContacts = 0;
+	uint16 CappedSprings = 0;
+	uint16 CappedDampers = 0;
+	uint8 LOD = 0;
+	uint8 Pad[3] = {};
+
+	float SpringForce = 0;
+	float DampForce = 0;
+	float FrictionForce = 0;
+	float GripStrength = 0;
+	float MaxSlip = 0;
+	float NetForce[3] = {};
+	float NetTorque[3] = {};
+
+	// Hit samples per eighth of compression
+	static const int32 HistogramBuckets = 8;
+	uint16 CompressionHistogram[HistogramBuckets] = {};
+};
+
+/**
+ * Single producer ring of telemetry records, read by any number of consumers with their own cursor.
+ * Every slot is a seqlock: the physics thread never waits, readers drop records overwritten while they copy them.
+ */
+class VENINE_API FTireTelemetryRing
+{
+public:
+
+	// Rounded up to a power of two
+	explicit FTireTelemetryRing(int32 InCapacity = 1024);
+
+	// Producer thread only
+	void Push(const FTireTelemetryRecord &Record);
+
+	// Appends every record from Cursor to the head and moves Cursor past them, returns how many were lost to the writer
+	int32 Read(uint64 &Cursor, TArray<FTireTelemetryRecord> &Out) const;
+
+	uint64 GetHead() const { return (uint64)FPlatformAtomics::AtomicRead(&Head); }
+
+private:
+
+	struct FSlot {
+		// 2N + 1 while record N is written, 2N + 2 once it is complete
+		volatile int64 Sequence = 0;
+		FTireTelemetryRecord Record;
+	};
+
+	TArray<FSlot> Slots;
+	uint64 Mask;
+	volatile int64 Head = 0;
+};
+
+/**
+ * Streams a telemetry ring to a file from its own thread.
+ * File layout: "TTEL", version, record size, then raw FTireTelemetryRecords.
+ */
+class VENINE_API FTireTelemetryWriter : public FRunnable
+{
+public:
+
+	FTireTelemetryWriter(const FTireTelemetryRing &InRing, const FString &InFilename);
+	// Flushes what is left in the ring and closes the file
+	virtual ~FTireTelemetryWriter();
+
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+
+	static const uint32 Magic = 0x4C455454;
+	static const uint32 Version = 1;
+
+private:
+
+	void Drain();
+
+	const FTireTelemetryRing &Ring;
+	FString Filename;
+	IFileHandle *File = nullptr;
+	FRunnableThread *Thread = nullptr;
+	FThreadSafeBool Stopping;
+
+	uint64 Cursor = 0;
+	int64 Lost = 0;
+	TArray<FTireTelemetryRecord> Buffer;
+};
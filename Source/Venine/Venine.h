@@ -4,3 +4,5 @@
 
 #include "CoreMinimal.h"
 
+DECLARE_STATS_GROUP(TEXT("AdvancedWheel"), STATGROUP_AdvancedWheel, STATCAT_Advanced);
+DECLARE_STATS_GROUP(TEXT("ProceduralLevel"), STATGROUP_ProceduralLevel, STATCAT_Advanced);